@@ -0,0 +1,31 @@
+#ifndef WARPC_AIO_H
+#define WARPC_AIO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Minimal asynchronous I/O ring (io_uring on Linux when built with
+ * HAVE_IO_URING; otherwise aio_create() returns NULL and callers use the
+ * blocking path). Buffers registered with aio_register_buffers() are
+ * submitted as fixed-buffer ops. Preparing/submitting is serialized by an
+ * internal lock so worker threads may post completions (aio_post);
+ * aio_wait() must only be called from a single reaper thread.
+ */
+struct aio_ring;
+
+struct aio_ring* aio_create(unsigned entries);
+void             aio_destroy(struct aio_ring* r);
+/* Registers bufs[i] of lens[i] bytes as fixed buffers; returns 0 on success */
+int              aio_register_buffers(struct aio_ring* r, void* const* bufs, const size_t* lens, size_t n);
+
+int  aio_read (struct aio_ring* r, int fd, void* buf, size_t n, uint64_t off, uint64_t tag);
+int  aio_write(struct aio_ring* r, int fd, const void* buf, size_t n, uint64_t off, uint64_t tag);
+/* Queues a no-op completion carrying `tag` and submits immediately */
+int  aio_post (struct aio_ring* r, uint64_t tag);
+/* Submits everything queued so far */
+int  aio_submit(struct aio_ring* r);
+/* Blocks for one completion; *res is bytes transferred or -errno */
+int  aio_wait (struct aio_ring* r, uint64_t* tag, int* res);
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef WARPC_ARCHIVE_H
+#define WARPC_ARCHIVE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "warp.h"
+
+/* One archive member as the compressor sees it: bytes [off, off + size) of
+ * the archive stream come from `path`. */
+typedef struct {
+  const char *path;
+  uint64_t    off;
+  uint64_t    size;
+} warp_member_t;
+
+/* warp_compress_file over the members back to back (total bytes in all),
+ * writing `man` (a WMAN block) as an extra trailer. In src/container.c. */
+int warp_compress_members(const warp_member_t *mem, uint32_t nmem, uint64_t total,
+                          const void *man, size_t man_len,
+                          const char *out_path, const warp_opts_t *opt);
+
+#endif
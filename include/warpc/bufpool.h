@@ -0,0 +1,49 @@
+#ifndef WARPC_BUFPOOL_H
+#define WARPC_BUFPOOL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Fixed set of equal-sized buffers carved from one slab. Free buffers sit on
+ * a lock-free (tagged Treiber) stack; a few single-buffer per-thread cache
+ * slots sit in front of it so a thread that releases and re-acquires keeps
+ * the same, cache-warm buffer. The pool never grows: callers that must not
+ * fail use pool_acquire_wait and block until a buffer comes back.
+ */
+#define BUFPOOL_CACHE 8
+
+struct bufpool_stats {
+  size_t hits;    /* acquires served immediately */
+  size_t misses;  /* acquires that found the pool empty */
+  size_t waits;   /* pool_acquire_wait calls that had to block */
+};
+
+struct bufpool {
+  unsigned char*   slab;
+  size_t           count;
+  size_t           bufsz;
+  size_t           stride;     /* bufsz rounded to a cache line */
+  atomic_uint*     next;       /* free-stack links, by index */
+  _Atomic uint64_t top;        /* (tag << 32) | (index + 1); 0 = empty */
+  atomic_size_t    cache[BUFPOOL_CACHE]; /* index + 1; 0 = empty */
+  atomic_size_t    hits, misses, waits;
+  atomic_int       waiters;
+  pthread_mutex_t  mtx;        /* only for blocked waiters */
+  pthread_cond_t   cv;
+};
+
+typedef struct bufpool bufpool_t;
+
+struct bufpool* pool_create(size_t count, size_t bufsz);
+/* Frees every buffer, including ones still checked out. */
+void            pool_destroy(struct bufpool* p);
+void*           pool_acquire(struct bufpool* p); /* may return NULL if empty */
+/* Blocks until a buffer is free; timeout_ms < 0 waits forever. NULL on timeout. */
+void*           pool_acquire_wait(struct bufpool* p, int timeout_ms);
+void            pool_release(struct bufpool* p, void* buf);
+void            pool_stats(struct bufpool* p, struct bufpool_stats* out);
+
+#endif
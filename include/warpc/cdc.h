@@ -0,0 +1,26 @@
+#ifndef WARPC_CDC_H
+#define WARPC_CDC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Content-defined chunk boundaries (warp_opts_t.cdc), FastCDC style: a gear
+ * rolling hash over the last 64 bytes, no cut before `min`, a strict mask up
+ * to `avg` and a loose one after it, forced cut at `max`. An insertion only
+ * moves the boundaries near it, so identical regions keep producing
+ * identical chunks wherever they sit in the file.
+ */
+typedef struct {
+  uint64_t gear[256];
+  uint64_t mask_s, mask_l;
+  size_t   min, avg, max;
+} cdc_t;
+
+/* Boundaries for chunks of at most max_len bytes (avg max/2, min max/8). */
+void   cdc_init(cdc_t *c, size_t max_len);
+/* Length of the next chunk of p[0..n); n should be at least c->max unless
+ * p runs to the end of the input. */
+size_t cdc_cut(const cdc_t *c, const unsigned char *p, size_t n);
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef WARPC_CODECS_H
+#define WARPC_CODECS_H
+
+#include <stddef.h>
+
+typedef struct {
+  const char* name;
+  int    (*compress_bound)(size_t src_size, size_t* out_bound);
+  size_t (*compress)(const void* src, size_t src_size, void* dst, size_t dst_cap, int level);
+  size_t (*decompress)(const void* src, size_t src_size, void* dst, size_t dst_cap);
+  /* Optional reusable state (NULL members = one-shot calls above only). A
+   * context is used by one thread at a time. */
+  void*  (*ctx_create)(void);
+  void   (*ctx_free)(void* ctx);
+  size_t (*compress_ctx)(void* ctx, const void* src, size_t src_size, void* dst, size_t dst_cap, int level);
+  size_t (*decompress_ctx)(void* ctx, const void* src, size_t src_size, void* dst, size_t dst_cap);
+  /* Optional: codec-internal threads for compress_ctx, splitting the input
+   * into jobs of about job_size bytes (0 workers = single-threaded).
+   * Returns 0, or -1 if the library cannot do it. */
+  int    (*ctx_set_workers)(void* ctx, int nb_workers, size_t job_size);
+} codec_vtable;
+
+const codec_vtable* warpc_get_codec_by_name(const char* name);
+const codec_vtable* warpc_get_codec_by_id(int id);
+int                 warpc_codec_id_from_name(const char* name);
+const char*         warpc_codec_name_from_id(int id);
+
+/* Compress/decompress through the calling thread's long-lived context for
+ * vt (created on first use, freed when the thread exits); codecs without
+ * context entry points use the one-shot calls. Return 0 on failure. */
+size_t warpc_codec_compress(const codec_vtable* vt, const void* src, size_t src_size,
+                            void* dst, size_t dst_cap, int level);
+size_t warpc_codec_decompress(const codec_vtable* vt, const void* src, size_t src_size,
+                              void* dst, size_t dst_cap);
+/* Sets the calling thread's intra-chunk worker count for vt; -1 if unsupported. */
+int    warpc_codec_set_workers(const codec_vtable* vt, int nb_workers, size_t job_size);
+
+/* Snappy is only a WARP v3 chunk algo (src/codecs_snappy.c, HAVE_SNAPPY);
+ * all three return 0 when it is not built in. */
+size_t snappy_max_compressed_size(size_t src_sz);
+size_t wc_snappy_compress(void* dst, size_t dst_cap, const void* src, size_t src_sz);
+size_t wc_snappy_decompress(void* dst, size_t dst_cap, const void* src, size_t src_sz);
+
+/* Defaults */
+#define WARPC_DEFAULT_CHUNK_KIB 16384 /* 16 MiB */
+#define WARPC_DEFAULT_LEVEL_ZSTD 3
+#define WARPC_DEFAULT_LEVEL_LZ4  0
+
+#endif
+
@@ -21,5 +21,9 @@ typedef struct {
 
 /* Each chunk is: [u64 uncompressed][u64 compressed][bytes...] */
 
+/* orig_size for streamed input (size unknown up front): records run until a
+ * [u64 0][u64 0] terminator instead of until orig_size bytes are produced. */
+#define WARPC_SIZE_STREAM UINT64_MAX
+
 #endif
 
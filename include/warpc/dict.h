@@ -0,0 +1,41 @@
+#ifndef WARPC_DICT_H
+#define WARPC_DICT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * zstd dictionary (`warpc train`, warp_opts_t.dict) and chunk-prefix helpers
+ * for WARP v3. The dictionary is digested once into a ZSTD_CDict/ZSTD_DDict
+ * that every worker shares read-only; each thread brings its own long-lived
+ * CCtx/DCtx.
+ */
+typedef struct warp_dict warp_dict_t;
+
+/* level > 0 also prepares compression at that level; NULL if zstd is not
+ * built in or the bytes are unusable. */
+warp_dict_t *warp_dict_create(const void *buf, size_t n, int level);
+warp_dict_t *warp_dict_load(const char *path, int level);
+void         warp_dict_free(warp_dict_t *d);
+uint32_t     warp_dict_id(const warp_dict_t *d);
+
+/* 0 on failure */
+size_t warp_dict_compress(const warp_dict_t *d, void *dst, size_t cap, const void *src, size_t n);
+size_t warp_dict_decompress(const warp_dict_t *d, void *dst, size_t cap, const void *src, size_t n);
+
+/* WDCT block (wdct_header_t + bytes) as stored in the container */
+uint64_t     warp_dict_block_size(const warp_dict_t *d);
+int          warp_dict_fwrite(FILE *fout, const warp_dict_t *d); /* 0 on success */
+warp_dict_t *warp_dict_fread(FILE *fin, int level);              /* at the current position */
+warp_dict_t *warp_dict_pread(int fd, uint64_t off, int level);
+
+/* Prefix mode (WARP_ALGO_ZSTD_REF): zstd against the raw bytes of another
+ * chunk as a single-use prefix, with long-distance matching and a window
+ * covering prefix + input. 0 on failure. */
+size_t warp_prefix_compress(void *dst, size_t cap, const void *src, size_t n,
+                            const void *prefix, size_t plen, int level);
+size_t warp_prefix_decompress(void *dst, size_t cap, const void *src, size_t n,
+                              const void *prefix, size_t plen);
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef WARPC_PROFILE_H
+#define WARPC_PROFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Host calibration profile (`warpc calibrate`): compression ratio and
+ * MB/s per data class, codec and level, measured on synthetic data. Auto
+ * mode classifies each chunk by its order-0 entropy and picks the codec
+ * from these numbers instead of running trials.
+ *
+ * On disk it is a text file:
+ *   warpc-profile 1
+ *   <class> <bits/byte> <codec> <level> <ratio> <MB/s>
+ */
+#define PROFILE_MAX   64
+#define PROFILE_CLASS 16
+
+typedef struct {
+  char   cls[PROFILE_CLASS]; /* data class name */
+  double bits;               /* order-0 entropy of the class sample */
+  int    algo;               /* WARP_ALGO_* */
+  int    level;              /* 0 for codecs without levels */
+  double ratio;              /* compressed / original */
+  double mbps;               /* compression speed */
+} profile_ent_t;
+
+typedef struct {
+  profile_ent_t ent[PROFILE_MAX];
+  int           n;
+} warp_profile_t;
+
+/* Compresses in[0..n) with a WARP_ALGO_* codec; 0 on failure. */
+typedef size_t (*profile_codec_fn)(int algo, const unsigned char* in, size_t n, int level,
+                                   unsigned char* out, size_t cap);
+
+/* $WARPC_PROFILE, else $XDG_CONFIG_HOME/warpc/profile, else ~/.config/warpc/profile.
+ * 0 on success, -1 if no location can be derived. */
+int    profile_default_path(char* buf, size_t cap);
+/* 0 on success, -1 if missing or malformed */
+int    profile_load(const char* path, warp_profile_t* p);
+/* Creates the parent directory if needed. 0 on success. */
+int    profile_save(const char* path, const warp_profile_t* p);
+/* Order-0 entropy in bits/byte of a byte histogram over `total` bytes */
+double profile_entropy(const uint32_t hist[256], double total);
+/* Entry for the class nearest to `bits`, for algo at the level nearest to
+ * `level`; NULL if the profile has none. */
+const profile_ent_t* profile_lookup(const warp_profile_t* p, double bits, int algo, int level);
+/* Measures every codec/level on each synthetic class; `cap` is the output
+ * buffer size needed for `n` input bytes. 0 on success. */
+int    profile_calibrate(warp_profile_t* p, profile_codec_fn run, size_t (*cap)(size_t),
+                         int verbose);
+
+#endif
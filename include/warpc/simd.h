@@ -0,0 +1,45 @@
+#ifndef WARPC_SIMD_H
+#define WARPC_SIMD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Byte-scanning kernels picked once at startup from the CPU's features
+ * (scalar, SSE2, AVX2, AVX-512BW on x86; NEON on ARM). WARPC_SIMD=<name>
+ * in the environment forces a variant, e.g. to compare against scalar.
+ */
+typedef struct {
+  const char* name;
+  /* Number of leading bytes equal to p[0] (0 when n == 0). */
+  size_t (*run_length)(const unsigned char* p, size_t n);
+  /* Folds n 64-byte blocks into eight 64-bit lanes (see whash64_*). */
+  void   (*hash_blocks)(uint64_t lane[8], const unsigned char* p, size_t nblocks);
+  /* Adds the byte counts of p[0..n) to hist. */
+  void   (*histogram)(const unsigned char* p, size_t n, uint32_t hist[256]);
+} simd_kernels_t;
+
+const simd_kernels_t* simd_kernels(void);
+/* A specific variant by name, or NULL if this build/CPU cannot run it. */
+const simd_kernels_t* simd_kernels_variant(const char* name);
+
+size_t simd_run_length(const void* p, size_t n);
+int    simd_is_zero(const void* p, size_t n);
+/* Fills hist with the byte counts of p[0..n). */
+void   simd_histogram(const void* p, size_t n, uint32_t hist[256]);
+
+/* Eight-lane FNV-style hash: lane k absorbs every 8th 64-bit word, which
+ * vectorizes, unlike byte-serial FNV-1a. Not persisted anywhere; used to
+ * compare data within one run (--verify). */
+typedef struct {
+  uint64_t      lane[8];
+  unsigned char tail[64];
+  size_t        tlen;
+  uint64_t      total;
+} whash64_t;
+
+void     whash64_init(whash64_t* h);
+void     whash64_update(whash64_t* h, const void* data, size_t n);
+uint64_t whash64_final(const whash64_t* h);
+
+#endif
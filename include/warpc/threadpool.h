@@ -0,0 +1,54 @@
+#ifndef WARPC_THREADPOOL_H
+#define WARPC_THREADPOOL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+
+/*
+ * Work-stealing pool: every worker owns a fixed ring of job slots, so
+ * submitting never allocates. Jobs from a worker go to its own deque, jobs
+ * from other threads are spread round-robin; idle workers steal from the
+ * others before sleeping.
+ */
+#define TP_DEQUE_CAP 256
+
+struct job {
+  void (*fn)(void*);
+  void* arg;
+};
+
+struct tp_deque {
+  pthread_mutex_t mtx;
+  size_t          head;  /* oldest slot */
+  size_t          count;
+  struct job      slots[TP_DEQUE_CAP];
+};
+
+struct threadpool {
+  pthread_t*       th;
+  size_t           nth;       /* deques */
+  size_t           nstarted;  /* threads actually running */
+  struct tp_deque* dq;        /* one per worker */
+  atomic_size_t    next;      /* round-robin target for outside submitters */
+  atomic_size_t    queued;    /* jobs sitting in deques */
+  atomic_size_t    active;    /* submitted and not yet finished */
+  atomic_int       idle;      /* workers parked on cv */
+  pthread_mutex_t  mtx;
+  pthread_cond_t   cv;        /* work available / stop */
+  pthread_cond_t   done_cv;   /* active dropped to 0 */
+  int              stop;
+};
+
+typedef struct threadpool tp_t;
+
+struct threadpool* tp_create(size_t nthreads);
+/* Runs every job still queued, then joins the workers. */
+void               tp_destroy(struct threadpool* tp);
+/* Returns 0 on success. Never allocates; when every deque is full the job
+ * runs on the calling thread instead. */
+int                tp_submit(struct threadpool* tp, void (*fn)(void*), void* arg);
+/* Blocks until every job submitted so far has finished. */
+void               tp_barrier(struct threadpool* tp);
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef WARPC_UTIL_H
+#define WARPC_UTIL_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h> /* off_t */
+
+int  read_all(int fd, void* buf, size_t n);
+/* Reads until n bytes or EOF (pipes); returns bytes read, or -1 on error */
+ssize_t read_upto(int fd, void* buf, size_t n);
+int  write_all(int fd, const void* buf, size_t n);
+int  pread_all(int fd, void* buf, size_t n, off_t off);
+int  pwrite_all(int fd, const void* buf, size_t n, off_t off);
+/* WARP v3 engine flavours: bytes moved (short only at EOF), -1 on error */
+ssize_t wc_pread(int fd, void* buf, size_t n, uint64_t off);
+ssize_t wc_pwrite(int fd, const void* buf, size_t n, uint64_t off);
+void    wc_advise_sequential(int fd);
+int     wc_ftruncate_file(FILE* f, uint64_t size); /* 0 on success */
+int  file_stat_size(const char* path, uint64_t* out);
+int  file_open_rd(const char* path);
+int  file_open_wr(const char* path);
+int  file_open_trunc(const char* path);
+int  file_is_seekable(int fd); /* regular file (pread/pwrite/lseek usable) */
+
+/* Read-only mapping of a whole file for zero-copy input. Returns NULL when
+ * the file is empty, too large for the address space or mmap fails; callers
+ * then fall back to pread. Advises sequential access. */
+const void* file_map_rd(int fd, uint64_t size);
+void        file_unmap(const void* p, uint64_t size);
+/* Readahead hint for [off, off+len) of a mapping */
+void        file_map_willneed(const void* base, uint64_t off, size_t len);
+
+/* Vectorized 64-bit file hash (simd.h whash64) for bench round trips; 0 on I/O error */
+uint64_t whash64_file(const char* path, size_t chunk);
+
+#endif
+
@@ -0,0 +1,249 @@
+#ifndef WARP_H
+#define WARP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/* Container v3 */
+#define WARP_MAGIC 0x50524157u /* 'WARP' little-endian */
+#define WARP_VER   3
+
+/* Algorithms */
+enum {
+  WARP_ALGO_ZSTD   = 1,
+  WARP_ALGO_LZ4    = 2,
+  WARP_ALGO_SNAPPY = 3,
+  WARP_ALGO_COPY   = 4, /* raw/no compression */
+  WARP_ALGO_ZERO   = 5, /* virtual zero run (no payload) */
+  WARP_ALGO_ZSTD_REF = 6, /* zstd with the raw data of chunk (index - ref) as prefix */
+  WARP_ALGO_DUP    = 7  /* same data as chunk (index - ref); offset/comp_len repeat its payload */
+};
+
+/* Checksum kinds (trailers) */
+enum {
+  WARP_CHK_NONE  = 0,
+  WARP_CHK_XXH64 = 1, /* one digest of the whole original */
+  WARP_CHK_XXH3  = 2  /* XXH3-64 of each chunk's original bytes */
+};
+
+/* Auto target modes */
+enum {
+  WARP_AUTO_THROUGHPUT = 0,
+  WARP_AUTO_BALANCED   = 1,
+  WARP_AUTO_RATIO      = 2
+};
+
+/* Header flags */
+#define WARP_FLAG_STREAM 0x0001u /* streamed layout, see below */
+#define WARP_FLAG_DICT   0x0002u /* WDCT block before the payloads; zstd chunks use it */
+#define WARP_FLAG_PREFIX 0x0004u /* has WARP_ALGO_ZSTD_REF chunks */
+#define WARP_FLAG_APPEND 0x0008u /* appended segments, see below */
+
+/*
+ * Layouts:
+ *  - default: header, chunk table (chunk_count entries), payloads, trailers.
+ *  - WARP_FLAG_STREAM (written without seeking, e.g. to a pipe): header with
+ *    chunk_count/orig_size/comp_size = 0, then per chunk a warp_chunk_t entry
+ *    followed by its payload, then an entry with orig_len == 0 as terminator.
+ *    The WIX trailer is always present and is the authoritative table.
+ *  - WARP_FLAG_DICT: a WDCT block (zstd dictionary) follows the chunk table,
+ *    or the header in the stream layout, so pipe decoders have it before the
+ *    first payload.
+ *  - Prefix groups (warp_opts_t.prefix_group): runs of chunks whose first
+ *    chunk is self-contained and the rest are WARP_ALGO_ZSTD_REF against its
+ *    raw data. Groups are independent; a random read decodes at most one
+ *    extra chunk (the group's first).
+ *  - WARP_ALGO_DUP entries (default layout, warp_opts_t.cdc) point at an
+ *    earlier chunk's payload instead of storing their own, so chunk
+ *    payloads are no longer strictly in table order.
+ *  - WARP_FLAG_APPEND (warp_append_file): each append adds a segment after
+ *    the previous trailers: payloads, a WIX of its own chunks and a footer
+ *    whose wftr_ext_t.prev_ftr points at the previous footer. The chunk
+ *    table is the segments' tables oldest first (the first may be the
+ *    table after the header); header chunk_count/orig_size describe the
+ *    first segment only. warp_compact folds the chain into one table.
+ */
+
+/* Header at file start */
+typedef struct {
+  uint32_t magic;       /* WARP_MAGIC */
+  uint8_t  version;     /* WARP_VER */
+  uint8_t  base_algo;   /* default/base algo used */
+  uint16_t flags;       /* WARP_FLAG_* */
+  uint32_t chunk_size;  /* preferred chunk size */
+  uint32_t chunk_count; /* number of chunks */
+  uint64_t orig_size;   /* original total bytes */
+  uint64_t comp_size;   /* total payload bytes */
+} warp_header_t;
+
+/* Table entry per chunk (includes algo) */
+typedef struct {
+  uint32_t orig_len;
+  uint32_t comp_len;
+  uint64_t offset;
+  uint8_t  algo;
+  uint8_t  _pad[3];
+  uint32_t ref;     /* WARP_ALGO_ZSTD_REF/DUP: distance back to the prefix/original chunk, else 0 */
+} warp_chunk_t;
+
+/* Trailers */
+#define WIX_MAGIC  0x31584957u /* "WIX1" */
+#define WCHK_MAGIC 0x4B484357u /* "WCHK" */
+#define WFTR_MAGIC 0x52544657u /* "WFTR" */
+#define WDCT_MAGIC 0x54434457u /* "WDCT" */
+#define WMAN_MAGIC 0x4E414D57u /* "WMAN" */
+
+typedef struct {
+  uint32_t magic;  /* WIX_MAGIC */
+  uint32_t count;  /* entries */
+} wix_header_t;
+
+typedef struct {
+  uint64_t payload_off;
+  uint32_t orig_len;
+  uint32_t comp_len;
+  uint8_t  algo;
+  uint8_t  _pad[3];
+  uint32_t ref;     /* as warp_chunk_t.ref */
+} wix_entry_v1_t;
+
+/* WCHK: WARP_CHK_XXH64 is followed by the digest; WARP_CHK_XXH3 by a
+ * uint32_t chunk count (the segment's) and one digest per chunk in table
+ * order, 0 for chunks that are not checked (ZERO). */
+typedef struct {
+  uint32_t magic; /* WCHK_MAGIC */
+  uint8_t  kind;  /* WARP_CHK_* */
+  uint8_t  dlen;  /* digest length */
+  uint8_t  _rsv[2];
+} wchk_header_t;
+
+typedef struct {
+  uint32_t magic;   /* WDCT_MAGIC */
+  uint32_t dict_id; /* zstd dictionary ID (0 = raw content) */
+  uint32_t size;    /* dictionary bytes that follow */
+  uint32_t _rsv;
+} wdct_header_t;
+
+/* Archive manifest (warp_archive_create): header, count entries, then the
+ * names back to back without terminators, in entry order. Entry data is
+ * [offset, offset + size) of the decompressed stream. */
+typedef struct {
+  uint32_t magic;     /* WMAN_MAGIC */
+  uint32_t count;
+  uint64_t names_len;
+} wman_header_t;
+
+typedef struct {
+  uint64_t offset;
+  uint64_t size;      /* 0 for directories */
+  int64_t  mtime;     /* seconds */
+  uint32_t mode;      /* st_mode: S_IFREG or S_IFDIR plus permissions */
+  uint32_t name_len;  /* relative path, '/'-separated */
+} wman_entry_t;
+
+/* Footer flags */
+#define WFTR_FLAG_EXT 0x0001u /* a wftr_ext_t sits right before the footer */
+
+/* Footer: add a reserved u32 so designated or positional init works */
+typedef struct {
+  uint32_t magic;   /* WFTR_MAGIC */
+  uint32_t flags;   /* WFTR_FLAG_* (0 from older writers) */
+  uint64_t wix_off; /* 0 if absent */
+  uint64_t chk_off; /* 0 if absent */
+} wftr_footer_t;
+
+/* Footer extension; readers that predate it only see the footer */
+typedef struct {
+  uint64_t man_off;  /* WMAN manifest, 0 if absent */
+  uint64_t prev_ftr; /* WARP_FLAG_APPEND: previous segment's footer, 0 for the first */
+  uint64_t _rsv;     /* reserved (must be written as 0) */
+} wftr_ext_t;
+
+/* CLI options */
+typedef struct {
+  int algo;        /* 0=auto, else explicit WARP_ALGO_* */
+  int auto_mode;   /* WARP_AUTO_* */
+  int auto_lock;   /* warm-up chunks before the adaptive policy starts (default 4) */
+  size_t sample_bytes; /* auto-mode trial budget per codec (0 = 1 MiB; >= chunk tries it whole) */
+  const char *profile; /* auto-mode calibration profile; NULL = default location, "" = none */
+  const char *dict;    /* zstd dictionary file (warpc train); NULL or "" = none; appends only check it matches the container's */
+  int prefix_group;    /* > 1: zstd chunks reference the first chunk of their group
+                          of this many (long-distance matching on, used instead of
+                          dict); file inputs only, streamed input ignores it */
+  int cdc;             /* content-defined chunk boundaries (max chunk_bytes, average half
+                          that) and, with xxHash, dedup of identical chunks as
+                          WARP_ALGO_DUP; file inputs only, excludes prefix_group */
+  int level;       /* codec level (zstd) */
+  int threads;     /* worker threads */
+  int chunk_bytes; /* 0 = auto policy */
+  int do_index;    /* write WIX */
+  int chk_kind;    /* WARP_CHK_* (needs xxHash, refused without it); XXH64 is not written by appends */
+  int verify;      /* verify on decompress (per-chunk sums are checked by the workers) */
+  int verbose;
+  int no_mmap;     /* read input with pread instead of mmap */
+} warp_opts_t;
+
+/* Chunk policy (adaptive); implemented in src/util.c */
+uint32_t warp_pick_chunk_size(size_t bytes);
+
+/* High-level API */
+int warp_compress_file  (const char *in_path, const char *out_path, const warp_opts_t *opt);
+int warp_decompress_file(const char *in_path, const char *out_path, const warp_opts_t *opt);
+
+/* Benchmarks each codec/level on synthetic data classes and writes the
+ * profile auto mode uses (path NULL = default location, see profile.h). */
+int warp_calibrate(const char *path, int verbose);
+
+/* Trains a zstd dictionary of about dict_bytes (0 = 112 KiB) from sample
+ * files (large ones are cut into 64 KiB samples), writes it to
+ * dict_path and reports ratio/throughput with and without it. */
+int warp_train_dict(const char *dict_path, const char *const *samples, int nsamples,
+                    size_t dict_bytes, int level, int verbose);
+
+/* Appends the bytes of in_path past the container's current size as a new
+ * segment (the earlier bytes are assumed unchanged, as for a growing log);
+ * existing payloads and trailers are not touched. Codec options come from
+ * opt, chunk size and dictionary from the container. Not for archives.
+ * A missing container is created from the whole input, as by
+ * warp_compress_file. */
+int warp_append_file(const char *in_path, const char *warp_path, const warp_opts_t *opt);
+/* Rewrites an appended container with a single table (payloads are copied,
+ * not recompressed). */
+int warp_compact(const char *warp_path, const warp_opts_t *opt);
+
+/* Archives (src/archive.c): the regular files under dir are stored back to
+ * back as one stream, so small files share chunks, with a WMAN manifest
+ * trailer. Extraction goes through warp_reader and decodes only the chunks
+ * of the selected members (NULL/0 = all; a directory selects its subtree). */
+int warp_archive_create (const char *dir, const char *out_path, const warp_opts_t *opt);
+int warp_archive_list   (const char *path, FILE *out);
+int warp_archive_extract(const char *path, const char *dest_dir,
+                         const char *const *members, int nmembers, const warp_opts_t *opt);
+
+/* Random access (implemented in src/reader.c). Uses the WIX trailer when
+ * present (else the header table) and decodes only overlapping chunks;
+ * decoded chunks are kept in an LRU cache bounded by cache_bytes and
+ * checked against their WARP_CHK_XXH3 sums when the file has them.
+ * Calls on one handle are serialized internally. */
+typedef struct warp_reader warp_reader_t;
+
+warp_reader_t *warp_open(const char *path, size_t cache_bytes);
+/* The complete chunk table of a container (all appended segments, entries
+ * as stored); caller frees. With sums, also the WARP_CHK_XXH3 sums per
+ * chunk (0 = unchecked), or NULL if no segment has them. 0 on success. */
+int            warp_read_table(int fd, warp_chunk_t **table, uint32_t *count, uint64_t **sums);
+void           warp_close(warp_reader_t *h);
+uint64_t       warp_reader_size(const warp_reader_t *h);
+/* Returns bytes copied into buf (short only at end of data), -1 on error */
+int64_t        warp_read_range(warp_reader_t *h, uint64_t offset, size_t len, void *buf);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* WARP_H */
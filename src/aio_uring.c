@@ -0,0 +1,233 @@
+#define _GNU_SOURCE /* syscall, MAP_POPULATE */
+#include "warpc/aio.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+
+struct aio_ring {
+  int fd;
+  /* submission queue */
+  unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+  struct io_uring_sqe *sqes;
+  unsigned sq_entries;
+  unsigned queued;          /* prepared but not yet submitted */
+  /* completion queue */
+  unsigned *cq_head, *cq_tail, *cq_mask;
+  struct io_uring_cqe *cqes;
+  /* mappings */
+  void *sq_ptr, *cq_ptr;
+  size_t sq_sz, cq_sz, sqes_sz;
+  /* fixed buffers */
+  void** bufs;
+  size_t* lens;
+  size_t nbufs;
+  pthread_mutex_t mtx;
+};
+
+static int sys_setup(unsigned entries, struct io_uring_params* p) {
+  return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+static int sys_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+  return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+static int sys_register(int fd, unsigned op, const void* arg, unsigned n) {
+  return (int)syscall(__NR_io_uring_register, fd, op, arg, n);
+}
+
+struct aio_ring* aio_create(unsigned entries) {
+  struct io_uring_params p;
+  memset(&p, 0, sizeof(p));
+  struct aio_ring* r = (struct aio_ring*)calloc(1, sizeof(*r));
+  if (!r) return NULL;
+  r->fd = sys_setup(entries, &p);
+  if (r->fd < 0) { free(r); return NULL; }
+
+  r->sq_sz = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  r->cq_sz = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    if (r->cq_sz > r->sq_sz) r->sq_sz = r->cq_sz;
+    r->cq_sz = r->sq_sz;
+  }
+  r->sq_ptr = mmap(NULL, r->sq_sz, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+  if (r->sq_ptr == MAP_FAILED) { close(r->fd); free(r); return NULL; }
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    r->cq_ptr = r->sq_ptr;
+  } else {
+    r->cq_ptr = mmap(NULL, r->cq_sz, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+    if (r->cq_ptr == MAP_FAILED) { munmap(r->sq_ptr, r->sq_sz); close(r->fd); free(r); return NULL; }
+  }
+  r->sqes_sz = p.sq_entries * sizeof(struct io_uring_sqe);
+  r->sqes = (struct io_uring_sqe*)mmap(NULL, r->sqes_sz, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, r->fd, IORING_OFF_SQES);
+  if (r->sqes == MAP_FAILED) {
+    if (r->cq_ptr != r->sq_ptr) munmap(r->cq_ptr, r->cq_sz);
+    munmap(r->sq_ptr, r->sq_sz); close(r->fd); free(r); return NULL;
+  }
+
+  char* sq = (char*)r->sq_ptr;
+  char* cq = (char*)r->cq_ptr;
+  r->sq_head  = (unsigned*)(sq + p.sq_off.head);
+  r->sq_tail  = (unsigned*)(sq + p.sq_off.tail);
+  r->sq_mask  = (unsigned*)(sq + p.sq_off.ring_mask);
+  r->sq_array = (unsigned*)(sq + p.sq_off.array);
+  r->sq_entries = p.sq_entries;
+  r->cq_head  = (unsigned*)(cq + p.cq_off.head);
+  r->cq_tail  = (unsigned*)(cq + p.cq_off.tail);
+  r->cq_mask  = (unsigned*)(cq + p.cq_off.ring_mask);
+  r->cqes     = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+  pthread_mutex_init(&r->mtx, NULL);
+  return r;
+}
+
+void aio_destroy(struct aio_ring* r) {
+  if (!r) return;
+  if (r->bufs) sys_register(r->fd, IORING_UNREGISTER_BUFFERS, NULL, 0);
+  munmap(r->sqes, r->sqes_sz);
+  if (r->cq_ptr != r->sq_ptr) munmap(r->cq_ptr, r->cq_sz);
+  munmap(r->sq_ptr, r->sq_sz);
+  close(r->fd);
+  pthread_mutex_destroy(&r->mtx);
+  free(r->bufs);
+  free(r->lens);
+  free(r);
+}
+
+int aio_register_buffers(struct aio_ring* r, void* const* bufs, const size_t* lens, size_t n) {
+  struct iovec* iov = (struct iovec*)calloc(n, sizeof(*iov));
+  void** copy = (void**)calloc(n, sizeof(*copy));
+  size_t* lcopy = (size_t*)calloc(n, sizeof(*lcopy));
+  if (!iov || !copy || !lcopy) { free(iov); free(copy); free(lcopy); return -1; }
+  for (size_t i = 0; i < n; ++i) {
+    iov[i].iov_base = bufs[i]; iov[i].iov_len = lens[i];
+    copy[i] = bufs[i]; lcopy[i] = lens[i];
+  }
+  int rc = sys_register(r->fd, IORING_REGISTER_BUFFERS, iov, (unsigned)n);
+  free(iov);
+  if (rc < 0) { free(copy); free(lcopy); return -1; } /* e.g. RLIMIT_MEMLOCK: plain ops still work */
+  r->bufs = copy; r->lens = lcopy; r->nbufs = n;
+  return 0;
+}
+
+static int fixed_index(const struct aio_ring* r, const void* buf, size_t n) {
+  for (size_t i = 0; i < r->nbufs; ++i) {
+    const char* b = (const char*)r->bufs[i];
+    if ((const char*)buf >= b && (const char*)buf + n <= b + r->lens[i]) return (int)i;
+  }
+  return -1;
+}
+
+static int submit_locked(struct aio_ring* r) {
+  while (r->queued) {
+    int n = sys_enter(r->fd, r->queued, 0, 0);
+    if (n < 0) { if (errno == EINTR || errno == EAGAIN || errno == EBUSY) continue; return -1; }
+    r->queued -= (unsigned)n;
+  }
+  return 0;
+}
+
+/* Caller holds r->mtx. Returns a zeroed SQE, flushing the queue if full. */
+static struct io_uring_sqe* get_sqe(struct aio_ring* r) {
+  unsigned head = __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+  unsigned tail = *r->sq_tail;
+  if (tail - head >= r->sq_entries) {
+    if (submit_locked(r) != 0) return NULL;
+    head = __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+    if (tail - head >= r->sq_entries) return NULL;
+  }
+  unsigned idx = tail & *r->sq_mask;
+  struct io_uring_sqe* sqe = &r->sqes[idx];
+  memset(sqe, 0, sizeof(*sqe));
+  r->sq_array[idx] = idx;
+  return sqe;
+}
+
+static void push_sqe(struct aio_ring* r) {
+  __atomic_store_n(r->sq_tail, *r->sq_tail + 1, __ATOMIC_RELEASE);
+  r->queued++;
+}
+
+static int prep_rw(struct aio_ring* r, int write, int fd, const void* buf, size_t n, uint64_t off, uint64_t tag) {
+  pthread_mutex_lock(&r->mtx);
+  struct io_uring_sqe* sqe = get_sqe(r);
+  if (!sqe) { pthread_mutex_unlock(&r->mtx); return -1; }
+  int bi = fixed_index(r, buf, n);
+  if (bi >= 0) {
+    sqe->opcode = (uint8_t)(write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED);
+    sqe->buf_index = (uint16_t)bi;
+  } else {
+    sqe->opcode = (uint8_t)(write ? IORING_OP_WRITE : IORING_OP_READ);
+  }
+  sqe->fd = fd;
+  sqe->addr = (uint64_t)(uintptr_t)buf;
+  sqe->len = (uint32_t)n;
+  sqe->off = off;
+  sqe->user_data = tag;
+  push_sqe(r);
+  pthread_mutex_unlock(&r->mtx);
+  return 0;
+}
+
+int aio_read(struct aio_ring* r, int fd, void* buf, size_t n, uint64_t off, uint64_t tag) {
+  return prep_rw(r, 0, fd, buf, n, off, tag);
+}
+
+int aio_write(struct aio_ring* r, int fd, const void* buf, size_t n, uint64_t off, uint64_t tag) {
+  return prep_rw(r, 1, fd, buf, n, off, tag);
+}
+
+int aio_post(struct aio_ring* r, uint64_t tag) {
+  pthread_mutex_lock(&r->mtx);
+  struct io_uring_sqe* sqe = get_sqe(r);
+  int rc = -1;
+  if (sqe) {
+    sqe->opcode = IORING_OP_NOP;
+    sqe->user_data = tag;
+    push_sqe(r);
+    rc = submit_locked(r);
+  }
+  pthread_mutex_unlock(&r->mtx);
+  return rc;
+}
+
+int aio_submit(struct aio_ring* r) {
+  pthread_mutex_lock(&r->mtx);
+  int rc = submit_locked(r);
+  pthread_mutex_unlock(&r->mtx);
+  return rc;
+}
+
+int aio_wait(struct aio_ring* r, uint64_t* tag, int* res) {
+  for (;;) {
+    unsigned head = *r->cq_head;
+    if (head != __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE)) {
+      struct io_uring_cqe* cqe = &r->cqes[head & *r->cq_mask];
+      *tag = cqe->user_data;
+      *res = cqe->res;
+      __atomic_store_n(r->cq_head, head + 1, __ATOMIC_RELEASE);
+      return 0;
+    }
+    if (sys_enter(r->fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) return -1;
+  }
+}
+
+#else /* !HAVE_IO_URING */
+
+struct aio_ring { int unused; };
+
+struct aio_ring* aio_create(unsigned entries) { (void)entries; return NULL; }
+void aio_destroy(struct aio_ring* r) { (void)r; }
+int  aio_register_buffers(struct aio_ring* r, void* const* bufs, const size_t* lens, size_t n) { (void)r;(void)bufs;(void)lens;(void)n; return -1; }
+int  aio_read(struct aio_ring* r, int fd, void* buf, size_t n, uint64_t off, uint64_t tag) { (void)r;(void)fd;(void)buf;(void)n;(void)off;(void)tag; return -1; }
+int  aio_write(struct aio_ring* r, int fd, const void* buf, size_t n, uint64_t off, uint64_t tag) { (void)r;(void)fd;(void)buf;(void)n;(void)off;(void)tag; return -1; }
+int  aio_post(struct aio_ring* r, uint64_t tag) { (void)r;(void)tag; return -1; }
+int  aio_submit(struct aio_ring* r) { (void)r; return -1; }
+int  aio_wait(struct aio_ring* r, uint64_t* tag, int* res) { (void)r;(void)tag;(void)res; return -1; }
+
+#endif
@@ -0,0 +1,351 @@
+// src/archive.c
+#define _XOPEN_SOURCE 700
+#include "archive.h"
+#include "warp.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#define ARC_CACHE (64u << 20) /* extraction: decoded-chunk cache */
+#define ARC_PIECE (1u << 20)  /* extraction: bytes per read/write */
+
+/* ---------- directory walk ---------- */
+
+typedef struct {
+  char    *name;  /* relative to the archive root */
+  char    *path;  /* as opened while compressing */
+  uint64_t size;
+  int64_t  mtime;
+  uint32_t mode;
+} arc_ent_t;
+
+typedef struct {
+  arc_ent_t *v;
+  size_t     n, cap;
+} arc_list_t;
+
+static char *join(const char *a, const char *b) {
+  size_t la = strlen(a), lb = strlen(b);
+  char *s = (char*)malloc(la + lb + 2);
+  if (!s) return NULL;
+  memcpy(s, a, la);
+  s[la] = '/';
+  memcpy(s + la + 1, b, lb + 1);
+  return s;
+}
+
+static int push(arc_list_t *l, char *name, char *path, const struct stat *st) {
+  if (!name || !path) { free(name); free(path); return -1; }
+  if (l->n == l->cap) {
+    size_t ncap = l->cap ? l->cap * 2 : 256;
+    arc_ent_t *nv = (arc_ent_t*)realloc(l->v, ncap * sizeof(*nv));
+    if (!nv) { free(name); free(path); return -1; }
+    l->v = nv; l->cap = ncap;
+  }
+  arc_ent_t *e = &l->v[l->n++];
+  e->name  = name;
+  e->path  = path;
+  e->size  = S_ISREG(st->st_mode) ? (uint64_t)st->st_size : 0;
+  e->mtime = (int64_t)st->st_mtime;
+  e->mode  = (uint32_t)st->st_mode;
+  return 0;
+}
+
+static int cmp_str(const void *a, const void *b) {
+  return strcmp(*(const char* const*)a, *(const char* const*)b);
+}
+
+/* Depth-first in name order, so the layout does not depend on readdir. */
+static int walk(arc_list_t *l, const char *path, const char *rel, int verbose) {
+  DIR *d = opendir(path);
+  if (!d) { perror(path); return -1; }
+  char **names = NULL;
+  size_t n = 0, cap = 0;
+  int rc = 0;
+  struct dirent *de;
+  while (!rc && (de = readdir(d)) != NULL) {
+    if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0) continue;
+    if (n == cap) {
+      size_t ncap = cap ? cap * 2 : 64;
+      char **nn = (char**)realloc(names, ncap * sizeof(*nn));
+      if (!nn) { rc = -1; break; }
+      names = nn; cap = ncap;
+    }
+    if (!(names[n] = strdup(de->d_name))) rc = -1; else n++;
+  }
+  closedir(d);
+  if (n) qsort(names, n, sizeof(*names), cmp_str);
+
+  for (size_t i = 0; i < n && !rc; i++) {
+    char *full = join(path, names[i]);
+    char *name = rel ? join(rel, names[i]) : strdup(names[i]);
+    struct stat st;
+    if (!full || !name || lstat(full, &st) != 0) { perror(full ? full : path); free(full); free(name); rc = -1; break; }
+    if (S_ISDIR(st.st_mode)) {
+      if ((rc = push(l, name, full, &st)) == 0) rc = walk(l, l->v[l->n - 1].path, l->v[l->n - 1].name, verbose);
+    } else if (S_ISREG(st.st_mode)) {
+      rc = push(l, name, full, &st);
+    } else {
+      if (verbose) fprintf(stderr, "skipping %s (not a regular file or directory)\n", full);
+      free(full); free(name);
+    }
+  }
+  for (size_t i = 0; i < n; i++) free(names[i]);
+  free(names);
+  return rc;
+}
+
+static void list_free(arc_list_t *l) {
+  for (size_t i = 0; i < l->n; i++) { free(l->v[i].name); free(l->v[i].path); }
+  free(l->v);
+}
+
+/* ---------- manifest ---------- */
+
+/* Serializes the WMAN block; members get their stream offsets. */
+static unsigned char *build_manifest(const arc_list_t *l, warp_member_t *mem, uint32_t *nmem,
+                                     uint64_t *total, size_t *len_out) {
+  uint64_t names_len = 0;
+  for (size_t i = 0; i < l->n; i++) names_len += strlen(l->v[i].name);
+  const size_t len = sizeof(wman_header_t) + l->n * sizeof(wman_entry_t) + (size_t)names_len;
+  unsigned char *buf = (unsigned char*)malloc(len);
+  if (!buf) return NULL;
+
+  wman_header_t h = { WMAN_MAGIC, (uint32_t)l->n, names_len };
+  memcpy(buf, &h, sizeof(h));
+  unsigned char *ep = buf + sizeof(h), *np = ep + l->n * sizeof(wman_entry_t);
+  uint64_t off = 0;
+  uint32_t m = 0;
+  for (size_t i = 0; i < l->n; i++) {
+    const arc_ent_t *a = &l->v[i];
+    wman_entry_t e;
+    memset(&e, 0, sizeof(e));
+    e.offset   = S_ISREG(a->mode) ? off : 0;
+    e.size     = a->size;
+    e.mtime    = a->mtime;
+    e.mode     = a->mode;
+    e.name_len = (uint32_t)strlen(a->name);
+    memcpy(ep, &e, sizeof(e)); ep += sizeof(e);
+    memcpy(np, a->name, e.name_len); np += e.name_len;
+    if (a->size) { mem[m].path = a->path; mem[m].off = off; mem[m].size = a->size; m++; }
+    off += a->size;
+  }
+  *nmem = m; *total = off; *len_out = len;
+  return buf;
+}
+
+typedef struct {
+  wman_entry_t *ent;
+  char        **name; /* NUL-terminated copies */
+  uint32_t      n;
+  uint64_t      stream_size;
+} manifest_t;
+
+static void manifest_free(manifest_t *m) {
+  if (m->name) for (uint32_t i = 0; i < m->n; i++) free(m->name[i]);
+  free(m->name);
+  free(m->ent);
+}
+
+/* Locates the manifest through the footer extension. 0, or -1 if the file
+ * is not an archive or the manifest is damaged. */
+static int read_manifest(int fd, manifest_t *m) {
+  memset(m, 0, sizeof(*m));
+  struct stat st;
+  wftr_footer_t ft;
+  wftr_ext_t ext;
+  wman_header_t h;
+  if (fstat(fd, &st) != 0 || (uint64_t)st.st_size < sizeof(ft) + sizeof(ext)) return -1;
+  const uint64_t fsz = (uint64_t)st.st_size, ext_off = fsz - sizeof(ft) - sizeof(ext);
+  if (pread_all(fd, &ft, sizeof(ft), (off_t)(fsz - sizeof(ft))) != 0 || ft.magic != WFTR_MAGIC ||
+      !(ft.flags & WFTR_FLAG_EXT) || pread_all(fd, &ext, sizeof(ext), (off_t)ext_off) != 0 || !ext.man_off ||
+      ext.man_off + sizeof(h) > ext_off || pread_all(fd, &h, sizeof(h), (off_t)ext.man_off) != 0 ||
+      h.magic != WMAN_MAGIC) return -1;
+  const uint64_t ents_len = (uint64_t)h.count * sizeof(wman_entry_t);
+  if (ext.man_off + sizeof(h) + ents_len + h.names_len > ext_off) return -1;
+
+  char *names = (char*)malloc(h.names_len ? (size_t)h.names_len : 1);
+  m->ent  = (wman_entry_t*)malloc(h.count ? (size_t)ents_len : 1);
+  m->name = (char**)calloc(h.count ? h.count : 1, sizeof(*m->name));
+  int rc = (names && m->ent && m->name &&
+            pread_all(fd, m->ent, (size_t)ents_len, (off_t)(ext.man_off + sizeof(h))) == 0 &&
+            pread_all(fd, names, (size_t)h.names_len, (off_t)(ext.man_off + sizeof(h) + ents_len)) == 0) ? 0 : -1;
+  m->n = h.count;
+  uint64_t at = 0;
+  for (uint32_t i = 0; i < m->n && !rc; i++) {
+    const wman_entry_t *e = &m->ent[i];
+    if (at + e->name_len > h.names_len || !(m->name[i] = (char*)malloc((size_t)e->name_len + 1))) { rc = -1; break; }
+    memcpy(m->name[i], names + at, e->name_len);
+    m->name[i][e->name_len] = '\0';
+    at += e->name_len;
+    if (e->offset + e->size > m->stream_size) m->stream_size = e->offset + e->size;
+  }
+  free(names);
+  if (rc) manifest_free(m);
+  return rc;
+}
+
+/* ---------- extraction helpers ---------- */
+
+/* Relative, and no ".." component: nothing lands outside dest_dir. */
+static int safe_name(const char *s) {
+  if (!*s || *s == '/') return 0;
+  for (const char *p = s; *p; ) {
+    const char *q = strchr(p, '/');
+    size_t len = q ? (size_t)(q - p) : strlen(p);
+    if (len == 2 && p[0] == '.' && p[1] == '.') return 0;
+    p += len + (q != NULL);
+  }
+  return 1;
+}
+
+static int selected(const char *name, const char *const *members, int n) {
+  if (!members || n <= 0) return 1;
+  for (int i = 0; i < n; i++) {
+    size_t len = strlen(members[i]);
+    while (len > 1 && members[i][len - 1] == '/') len--;
+    if (strncmp(name, members[i], len) == 0 && (name[len] == '\0' || name[len] == '/')) return 1;
+  }
+  return 0;
+}
+
+/* mkdir -p */
+static int make_dirs(const char *path) {
+  char *dir = strdup(path);
+  if (!dir) return -1;
+  int rc = 0;
+  for (char *s = dir + 1; *s && !rc; s++) {
+    if (*s != '/') continue;
+    *s = '\0';
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) rc = -1;
+    *s = '/';
+  }
+  if (!rc && mkdir(dir, 0755) != 0 && errno != EEXIST) rc = -1;
+  free(dir);
+  return rc;
+}
+
+static int make_parent(const char *path) {
+  const char *slash = strrchr(path, '/');
+  if (!slash || slash == path) return 0;
+  char *dir = strndup(path, (size_t)(slash - path));
+  int rc = dir ? make_dirs(dir) : -1;
+  free(dir);
+  return rc;
+}
+
+static int extract_file(warp_reader_t *h, const wman_entry_t *e, const char *out, unsigned char *buf) {
+  int fd = open(out, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  if (fd < 0) { perror(out); return -1; }
+  int rc = 0;
+  for (uint64_t done = 0; done < e->size; ) {
+    size_t want = (e->size - done > ARC_PIECE) ? ARC_PIECE : (size_t)(e->size - done);
+    int64_t got = warp_read_range(h, e->offset + done, want, buf);
+    if (got != (int64_t)want) { fprintf(stderr, "%s: read failed\n", out); rc = -1; break; }
+    if (write_all(fd, buf, want) != 0) { perror(out); rc = -1; break; }
+    done += want;
+  }
+  if (!rc) {
+    struct timespec ts[2];
+    ts[0].tv_sec = ts[1].tv_sec = (time_t)e->mtime;
+    ts[0].tv_nsec = ts[1].tv_nsec = 0;
+    fchmod(fd, (mode_t)(e->mode & 07777));
+    futimens(fd, ts);
+  }
+  if (close(fd) != 0 && !rc) { perror(out); rc = -1; }
+  return rc;
+}
+
+/* ---------- public API ---------- */
+
+int warp_archive_create(const char *dir, const char *out_path, const warp_opts_t *opt) {
+  struct stat st;
+  if (stat(dir, &st) != 0 || !S_ISDIR(st.st_mode)) { fprintf(stderr, "%s: not a directory\n", dir); return 1; }
+  arc_list_t l;
+  memset(&l, 0, sizeof(l));
+  if (walk(&l, dir, NULL, opt->verbose) != 0) { list_free(&l); return 1; }
+  if (l.n > UINT32_MAX) { fprintf(stderr, "too many files\n"); list_free(&l); return 1; }
+
+  warp_member_t *mem = (warp_member_t*)malloc((l.n ? l.n : 1) * sizeof(*mem));
+  uint32_t nmem = 0;
+  uint64_t total = 0;
+  size_t man_len = 0;
+  unsigned char *man = mem ? build_manifest(&l, mem, &nmem, &total, &man_len) : NULL;
+  int rc = 3;
+  if (!man) fprintf(stderr, "OOM\n");
+  else rc = warp_compress_members(mem, nmem, total, man, man_len, out_path, opt);
+  if (!rc && opt->verbose)
+    fprintf(stderr, "archived %zu entries (%u non-empty files, %llu bytes)\n", l.n, nmem, (unsigned long long)total);
+  free(man);
+  free(mem);
+  list_free(&l);
+  return rc;
+}
+
+int warp_archive_list(const char *path, FILE *out) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) { perror(path); return 1; }
+  manifest_t m;
+  int rc = read_manifest(fd, &m);
+  close(fd);
+  if (rc) { fprintf(stderr, "%s: not a WARP archive\n", path); return 2; }
+  for (uint32_t i = 0; i < m.n; i++) {
+    const wman_entry_t *e = &m.ent[i];
+    fprintf(out, "%06o %12llu %s%s\n", (unsigned)e->mode & 0177777u, (unsigned long long)e->size,
+            m.name[i], S_ISDIR(e->mode) ? "/" : "");
+  }
+  manifest_free(&m);
+  return 0;
+}
+
+int warp_archive_extract(const char *path, const char *dest_dir,
+                         const char *const *members, int nmembers, const warp_opts_t *opt) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) { perror(path); return 1; }
+  manifest_t m;
+  int rc = read_manifest(fd, &m);
+  close(fd);
+  if (rc) { fprintf(stderr, "%s: not a WARP archive\n", path); return 2; }
+
+  warp_reader_t *h = warp_open(path, ARC_CACHE);
+  unsigned char *buf = (unsigned char*)malloc(ARC_PIECE);
+  if (!h || !buf || warp_reader_size(h) < m.stream_size) {
+    fprintf(stderr, "%s: cannot read archive data\n", path);
+    free(buf); warp_close(h); manifest_free(&m);
+    return 2;
+  }
+  if (make_dirs(dest_dir) != 0) { perror(dest_dir); free(buf); warp_close(h); manifest_free(&m); return 1; }
+
+  uint32_t files = 0;
+  uint64_t bytes = 0;
+  for (uint32_t i = 0; i < m.n; i++) {
+    const wman_entry_t *e = &m.ent[i];
+    if (!selected(m.name[i], members, nmembers)) continue;
+    if (!safe_name(m.name[i])) { fprintf(stderr, "skipping unsafe name %s\n", m.name[i]); rc = 2; continue; }
+    char *out = join(dest_dir, m.name[i]);
+    if (!out) { rc = 3; break; }
+    if (S_ISDIR(e->mode)) {
+      if (make_dirs(out) != 0) { perror(out); rc = 2; }
+      else chmod(out, (mode_t)(e->mode & 07777) | S_IRWXU);
+    } else if (S_ISREG(e->mode)) {
+      if (make_parent(out) != 0 || extract_file(h, e, out, buf) != 0) rc = 2;
+      else { files++; bytes += e->size; }
+    }
+    free(out);
+  }
+  if (opt && opt->verbose) fprintf(stderr, "extracted %u files, %llu bytes\n", files, (unsigned long long)bytes);
+
+  free(buf);
+  warp_close(h);
+  manifest_free(&m);
+  return rc;
+}
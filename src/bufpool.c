@@ -1,49 +1,124 @@
+#define _XOPEN_SOURCE 700
 #include "warpc/bufpool.h"
 #include <stdlib.h>
+#include <time.h>
+
+/* Threads are spread over the cache slots by a lazily assigned id. */
+static atomic_uint next_tid;
+static _Thread_local unsigned tls_tid;
+
+static size_t cache_slot(void) {
+  if (!tls_tid) tls_tid = atomic_fetch_add(&next_tid, 1) + 1;
+  return (size_t)tls_tid % BUFPOOL_CACHE;
+}
+
+static void* buf_at(struct bufpool* p, size_t idx) { return p->slab + idx * p->stride; }
+
+static void stack_push(struct bufpool* p, uint32_t idx) {
+  uint64_t old = atomic_load(&p->top);
+  for (;;) {
+    atomic_store_explicit(&p->next[idx], (unsigned)(old & 0xffffffffu), memory_order_relaxed);
+    uint64_t nw = ((old >> 32) + 1) << 32 | (uint64_t)(idx + 1);
+    if (atomic_compare_exchange_weak(&p->top, &old, nw)) return;
+  }
+}
+
+/* Returns index + 1, or 0 when empty. The tag defeats ABA. */
+static size_t stack_pop(struct bufpool* p) {
+  uint64_t old = atomic_load(&p->top);
+  for (;;) {
+    uint32_t cur = (uint32_t)(old & 0xffffffffu);
+    if (cur == 0) return 0;
+    unsigned nx = atomic_load_explicit(&p->next[cur - 1], memory_order_relaxed);
+    uint64_t nw = ((old >> 32) + 1) << 32 | (uint64_t)nx;
+    if (atomic_compare_exchange_weak(&p->top, &old, nw)) return cur;
+  }
+}
+
+static void* try_take(struct bufpool* p) {
+  size_t own = cache_slot();
+  size_t v = atomic_exchange(&p->cache[own], 0);
+  if (!v) v = stack_pop(p);
+  for (size_t k = 1; !v && k < BUFPOOL_CACHE; ++k) {  /* steal parked buffers last */
+    v = atomic_exchange(&p->cache[(own + k) % BUFPOOL_CACHE], 0);
+  }
+  return v ? buf_at(p, v - 1) : NULL;
+}
 
 struct bufpool* pool_create(size_t count, size_t bufsz) {
-  struct bufpool* pool = (struct bufpool*)malloc(sizeof(*pool));
+  if (count >= UINT32_MAX) return NULL;
+  struct bufpool* pool = (struct bufpool*)calloc(1, sizeof(*pool));
   if (!pool) return NULL;
   pool->count = count;
   pool->bufsz = bufsz;
-  pool->bufs = (void**)calloc(count, sizeof(void*));
-  if (!pool->bufs) { free(pool); return NULL; }
-  for (size_t i = 0; i < count; ++i) {
-    pool->bufs[i] = malloc(bufsz);
-    if (!pool->bufs[i]) {
-      for (size_t k = 0; k < i; ++k) free(pool->bufs[k]);
-      free(pool->bufs);
-      free(pool);
-      return NULL;
-    }
-  }
-  pool->head = count; /* all free */
+  pool->stride = (bufsz + 63) & ~(size_t)63;
+  if (pool->stride == 0) pool->stride = 64;
+  if (count > SIZE_MAX / pool->stride) { free(pool); return NULL; }
+  pool->slab = count ? (unsigned char*)aligned_alloc(64, count * pool->stride) : NULL;
+  pool->next = (atomic_uint*)calloc(count ? count : 1, sizeof(*pool->next));
+  if ((count && !pool->slab) || !pool->next) { free(pool->slab); free(pool->next); free(pool); return NULL; }
+  for (size_t i = count; i > 0; --i) stack_push(pool, (uint32_t)(i - 1)); /* all free, index 0 on top */
   pthread_mutex_init(&pool->mtx, NULL);
+  pthread_cond_init(&pool->cv, NULL);
   return pool;
 }
 
 void pool_destroy(struct bufpool* p) {
   if (!p) return;
-  for (size_t i = 0; i < p->count; ++i) free(p->bufs[i]);
-  free(p->bufs);
+  free(p->slab);
+  free(p->next);
   pthread_mutex_destroy(&p->mtx);
+  pthread_cond_destroy(&p->cv);
   free(p);
 }
 
 void* pool_acquire(struct bufpool* p) {
+  if (!p) return NULL;
+  void* out = try_take(p);
+  atomic_fetch_add(out ? &p->hits : &p->misses, 1);
+  return out; /* may be NULL if pool exhausted */
+}
+
+void* pool_acquire_wait(struct bufpool* p, int timeout_ms) {
+  void* out = pool_acquire(p);
+  if (out || !p || timeout_ms == 0) return out;
+
+  struct timespec until;
+  if (timeout_ms > 0) {
+    clock_gettime(CLOCK_REALTIME, &until);
+    until.tv_sec  += timeout_ms / 1000;
+    until.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (until.tv_nsec >= 1000000000L) { until.tv_sec++; until.tv_nsec -= 1000000000L; }
+  }
+  atomic_fetch_add(&p->waits, 1);
   pthread_mutex_lock(&p->mtx);
-  void* out = NULL;
-  if (p->head > 0) {
-    out = p->bufs[--p->head];
-    p->bufs[p->head] = NULL;
+  atomic_fetch_add(&p->waiters, 1); /* before re-checking, so a release cannot slip past */
+  while (!(out = try_take(p))) {
+    if (timeout_ms < 0) pthread_cond_wait(&p->cv, &p->mtx);
+    else if (pthread_cond_timedwait(&p->cv, &p->mtx, &until) != 0) { out = try_take(p); break; }
   }
+  atomic_fetch_sub(&p->waiters, 1);
   pthread_mutex_unlock(&p->mtx);
-  return out; /* may be NULL if pool exhausted */
+  return out;
 }
 
 void pool_release(struct bufpool* p, void* buf) {
-  if (!buf) return;
-  pthread_mutex_lock(&p->mtx);
-  if (p->head < p->count) p->bufs[p->head++] = buf; /* drop if full */
-  pthread_mutex_unlock(&p->mtx);
+  if (!p || !buf) return;
+  uintptr_t base = (uintptr_t)p->slab, at = (uintptr_t)buf;
+  if (!p->count || at < base || (at - base) % p->stride || (at - base) / p->stride >= p->count) return; /* not ours */
+  size_t off = (size_t)(at - base);
+  size_t idx = off / p->stride;
+  size_t empty = 0;
+  if (!atomic_compare_exchange_strong(&p->cache[cache_slot()], &empty, idx + 1)) stack_push(p, (uint32_t)idx);
+  if (atomic_load(&p->waiters) > 0) {
+    pthread_mutex_lock(&p->mtx);
+    pthread_cond_signal(&p->cv);
+    pthread_mutex_unlock(&p->mtx);
+  }
+}
+
+void pool_stats(struct bufpool* p, struct bufpool_stats* out) {
+  out->hits   = p ? atomic_load(&p->hits)   : 0;
+  out->misses = p ? atomic_load(&p->misses) : 0;
+  out->waits  = p ? atomic_load(&p->waits)  : 0;
 }
@@ -0,0 +1,38 @@
+// src/cdc.c
+#include "cdc.h"
+
+static uint64_t splitmix64(uint64_t *s) {
+  uint64_t z = (*s += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+/* `bits` one-bits at the top: with h = (h << 1) + gear[b] they depend on the
+ * most recent bytes only */
+static uint64_t top_mask(int bits) {
+  return bits <= 0 ? 0 : bits >= 64 ? ~0ULL : ~0ULL << (64 - bits);
+}
+
+void cdc_init(cdc_t *c, size_t max_len) {
+  uint64_t seed = 0x5741525043444331ULL; /* fixed: boundaries must not vary between runs */
+  for (int i = 0; i < 256; i++) c->gear[i] = splitmix64(&seed);
+  c->max = max_len ? max_len : 1;
+  c->avg = c->max / 2 ? c->max / 2 : 1;
+  c->min = c->max / 8;
+  int bits = 0;
+  while (((size_t)2 << bits) <= c->avg) bits++;
+  c->mask_s = top_mask(bits + 2); /* normalized chunking: sizes cluster around avg */
+  c->mask_l = top_mask(bits - 2);
+}
+
+size_t cdc_cut(const cdc_t *c, const unsigned char *p, size_t n) {
+  if (n <= c->min) return n;
+  const size_t end = n < c->max ? n : c->max;
+  const size_t mid = c->avg < end ? c->avg : end;
+  uint64_t h = 0;
+  size_t i = c->min;
+  for (; i < mid; i++) { h = (h << 1) + c->gear[p[i]]; if (!(h & c->mask_s)) return i + 1; }
+  for (; i < end; i++) { h = (h << 1) + c->gear[p[i]]; if (!(h & c->mask_l)) return i + 1; }
+  return end;
+}
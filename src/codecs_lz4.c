@@ -1,6 +1,7 @@
 #include "warpc/codecs.h"
 #include <stddef.h>
 #include <stdint.h>
+#include <stdlib.h>
 
 #ifdef HAVE_LZ4
 #include <lz4.h>
@@ -39,11 +40,37 @@ static size_t lz4_decompress(const void* src, size_t src_size, void* dst, size_t
 #endif
 }
 
+/* Per-thread LZ4_stream_t for the extState API (decompression is stateless). */
+static void* lz4_ctx_create(void) {
+#ifdef HAVE_LZ4
+  return malloc((size_t)LZ4_sizeofState());
+#else
+  return NULL;
+#endif
+}
+
+static void lz4_ctx_free(void* p) { free(p); }
+
+static size_t lz4_compress_ctx(void* state, const void* src, size_t src_size, void* dst, size_t dst_cap, int level) {
+#ifdef HAVE_LZ4
+  (void)level;
+  int n = LZ4_compress_fast_extState(state, (const char*)src, (char*)dst, (int)src_size, (int)dst_cap, 1);
+  if (n <= 0) return 0;
+  return (size_t)n;
+#else
+  (void)state;(void)src;(void)src_size;(void)dst;(void)dst_cap;(void)level;
+  return 0;
+#endif
+}
+
 static const codec_vtable LZ4_VT = {
   .name = "lz4",
   .compress_bound = lz4_bound,
   .compress = lz4_compress,
-  .decompress = lz4_decompress
+  .decompress = lz4_decompress,
+  .ctx_create = lz4_ctx_create,
+  .ctx_free = lz4_ctx_free,
+  .compress_ctx = lz4_compress_ctx
 };
 
 extern const codec_vtable* __warpc_register_codec(const codec_vtable* vt, int id);
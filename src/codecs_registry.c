@@ -1,4 +1,6 @@
 #include "warpc/codecs.h"
+#include <pthread.h>
+#include <stdlib.h>
 #include <string.h>
 
 #define MAX_CODECS 8
@@ -41,3 +43,56 @@ const char* warpc_codec_name_from_id(int id) {
   const codec_vtable* vt = warpc_get_codec_by_id(id);
   return vt ? vt->name : "unknown";
 }
+
+/* ---------- per-thread codec contexts ---------- */
+
+typedef struct {
+  void* ctx[MAX_CODECS]; /* indexed like g_codecs */
+} tls_ctxs;
+
+static pthread_key_t  g_ctx_key;
+static pthread_once_t g_ctx_once = PTHREAD_ONCE_INIT;
+
+static void tls_ctxs_free(void* p) {
+  tls_ctxs* t = (tls_ctxs*)p;
+  for (int i = 0; i < g_codec_count; ++i)
+    if (t->ctx[i]) g_codecs[i]->ctx_free(t->ctx[i]);
+  free(t);
+}
+
+static void ctx_key_init(void) { pthread_key_create(&g_ctx_key, tls_ctxs_free); }
+
+/* The calling thread's context for vt, or NULL (no context support / OOM) */
+static void* tls_ctx(const codec_vtable* vt) {
+  if (!vt->ctx_create) return NULL;
+  int slot = -1;
+  for (int i = 0; i < g_codec_count; ++i) if (g_codecs[i] == vt) { slot = i; break; }
+  if (slot < 0) return NULL;
+  pthread_once(&g_ctx_once, ctx_key_init);
+  tls_ctxs* t = (tls_ctxs*)pthread_getspecific(g_ctx_key);
+  if (!t) {
+    t = (tls_ctxs*)calloc(1, sizeof(*t));
+    if (!t || pthread_setspecific(g_ctx_key, t) != 0) { free(t); return NULL; }
+  }
+  if (!t->ctx[slot]) t->ctx[slot] = vt->ctx_create();
+  return t->ctx[slot];
+}
+
+size_t warpc_codec_compress(const codec_vtable* vt, const void* src, size_t src_size,
+                            void* dst, size_t dst_cap, int level) {
+  void* ctx = vt->compress_ctx ? tls_ctx(vt) : NULL;
+  return ctx ? vt->compress_ctx(ctx, src, src_size, dst, dst_cap, level)
+             : vt->compress(src, src_size, dst, dst_cap, level);
+}
+
+int warpc_codec_set_workers(const codec_vtable* vt, int nb_workers, size_t job_size) {
+  void* ctx = vt->ctx_set_workers ? tls_ctx(vt) : NULL;
+  return ctx ? vt->ctx_set_workers(ctx, nb_workers, job_size) : -1;
+}
+
+size_t warpc_codec_decompress(const codec_vtable* vt, const void* src, size_t src_size,
+                              void* dst, size_t dst_cap) {
+  void* ctx = vt->decompress_ctx ? tls_ctx(vt) : NULL;
+  return ctx ? vt->decompress_ctx(ctx, src, src_size, dst, dst_cap)
+             : vt->decompress(src, src_size, dst, dst_cap);
+}
@@ -1,6 +1,7 @@
 #include "warpc/codecs.h"
 #include <stddef.h>
 #include <stdint.h>
+#include <stdlib.h>
 
 #ifdef HAVE_ZSTD
 #include <zstd.h>
@@ -39,11 +40,91 @@ static size_t zstd_decompress(const void* src, size_t src_size, void* dst, size_
 #endif
 }
 
+/* Per-thread state: each side is allocated on first use, then reused. */
+typedef struct {
+#ifdef HAVE_ZSTD
+  ZSTD_CCtx* c;
+  ZSTD_DCtx* d;
+  int        workers;  /* ZSTD_c_nbWorkers currently set on c */
+  size_t     job_size;
+#else
+  int unused;
+#endif
+} zstd_ctx;
+
+static void* zstd_ctx_create(void) { return calloc(1, sizeof(zstd_ctx)); }
+
+static void zstd_ctx_free(void* p) {
+  zstd_ctx* z = (zstd_ctx*)p;
+#ifdef HAVE_ZSTD
+  if (z) { ZSTD_freeCCtx(z->c); ZSTD_freeDCtx(z->d); }
+#endif
+  free(z);
+}
+
+static size_t zstd_compress_ctx(void* p, const void* src, size_t src_size, void* dst, size_t dst_cap, int level) {
+#ifdef HAVE_ZSTD
+  zstd_ctx* z = (zstd_ctx*)p;
+  if (!z->c && !(z->c = ZSTD_createCCtx())) return zstd_compress(src, src_size, dst, dst_cap, level);
+  size_t n;
+  if (z->workers > 0) { /* ZSTD_compressCCtx would ignore nbWorkers */
+    if (ZSTD_isError(ZSTD_CCtx_setParameter(z->c, ZSTD_c_compressionLevel, level))) return 0;
+    n = ZSTD_compress2(z->c, dst, dst_cap, src, src_size);
+  } else {
+    n = ZSTD_compressCCtx(z->c, dst, dst_cap, src, src_size, level);
+  }
+  if (ZSTD_isError(n)) return 0;
+  return n;
+#else
+  (void)p;
+  return zstd_compress(src, src_size, dst, dst_cap, level);
+#endif
+}
+
+static int zstd_ctx_set_workers(void* p, int nb_workers, size_t job_size) {
+#ifdef HAVE_ZSTD
+  zstd_ctx* z = (zstd_ctx*)p;
+  if (nb_workers < 0) nb_workers = 0;
+  if (z->workers == nb_workers && z->job_size == job_size) return 0;
+  if (!z->c && !(z->c = ZSTD_createCCtx())) return -1;
+  if (ZSTD_isError(ZSTD_CCtx_setParameter(z->c, ZSTD_c_nbWorkers, nb_workers))) return -1; /* no ZSTD_MULTITHREAD */
+  if (nb_workers > 0 && ZSTD_isError(ZSTD_CCtx_setParameter(z->c, ZSTD_c_jobSize, (int)job_size))) {
+    ZSTD_CCtx_setParameter(z->c, ZSTD_c_nbWorkers, 0);
+    z->workers = 0;
+    return -1;
+  }
+  z->workers = nb_workers;
+  z->job_size = job_size;
+  return 0;
+#else
+  (void)p;(void)job_size;
+  return nb_workers > 0 ? -1 : 0;
+#endif
+}
+
+static size_t zstd_decompress_ctx(void* p, const void* src, size_t src_size, void* dst, size_t dst_cap) {
+#ifdef HAVE_ZSTD
+  zstd_ctx* z = (zstd_ctx*)p;
+  if (!z->d && !(z->d = ZSTD_createDCtx())) return zstd_decompress(src, src_size, dst, dst_cap);
+  size_t n = ZSTD_decompressDCtx(z->d, dst, dst_cap, src, src_size);
+  if (ZSTD_isError(n)) return 0;
+  return n;
+#else
+  (void)p;
+  return zstd_decompress(src, src_size, dst, dst_cap);
+#endif
+}
+
 static const codec_vtable ZSTD_VT = {
   .name = "zstd",
   .compress_bound = zstd_bound,
   .compress = zstd_compress,
-  .decompress = zstd_decompress
+  .decompress = zstd_decompress,
+  .ctx_create = zstd_ctx_create,
+  .ctx_free = zstd_ctx_free,
+  .compress_ctx = zstd_compress_ctx,
+  .decompress_ctx = zstd_decompress_ctx,
+  .ctx_set_workers = zstd_ctx_set_workers
 };
 
 /* Public registry helpers (shared across codec units) */
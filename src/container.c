@@ -1,9 +1,15 @@
 // src/container.c
-#include "container.h"
+#define _GNU_SOURCE /* SEEK_DATA / SEEK_HOLE */
+#include "warp.h"
 #include "threadpool.h"
 #include "codecs.h"
 #include "util.h"
 #include "bufpool.h"
+#include "simd.h"
+#include "profile.h"
+#include "dict.h"
+#include "cdc.h"
+#include "archive.h"
 
 #ifdef HAVE_XXHASH
 #  include <xxhash.h>
@@ -17,6 +23,8 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <time.h>
+#include <math.h>
+#include <pthread.h>
 #include <sys/types.h>
 
 /* ---------- tiny helpers ---------- */
@@ -27,12 +35,240 @@ static size_t fsize(const char *path) {
   return (size_t)st.st_size;
 }
 
-static int is_all_zero(const unsigned char *p, size_t n) {
-  const unsigned long long *q = (const unsigned long long*)p;
-  while (n >= sizeof(*q)) { if (*q++) return 0; n -= sizeof(*q); }
-  p = (const unsigned char*)q;
-  while (n--) if (*p++) return 0;
-  return 1;
+static int is_stdio(const char *path) { return strcmp(path, "-") == 0; }
+
+/* Chunks in flight per worker thread; each one owns an input and an output buffer. */
+#define WARP_WINDOW_PER_THREAD 2
+
+/* zstd and lz4 chunks go through the codecs.h registry (and the calling
+ * thread's codec context); all three return 0 when the codec is not built in. */
+static size_t reg_bound(const char *name, size_t n) {
+  const codec_vtable *vt = warpc_get_codec_by_name(name);
+  size_t b = 0;
+  return vt && vt->compress_bound(n, &b) == 0 ? b : 0;
+}
+
+static size_t reg_compress(const char *name, void *dst, size_t cap, const void *src, size_t n, int level) {
+  const codec_vtable *vt = warpc_get_codec_by_name(name);
+  return vt ? warpc_codec_compress(vt, src, n, dst, cap, level) : 0;
+}
+
+static size_t reg_decompress(const char *name, void *dst, size_t cap, const void *src, size_t n) {
+  const codec_vtable *vt = warpc_get_codec_by_name(name);
+  return vt ? warpc_codec_decompress(vt, src, n, dst, cap) : 0;
+}
+
+/* output cap = max bound among codecs for a single chunk */
+static size_t chunk_out_cap(size_t chunk) {
+  size_t out_cap = chunk;
+  size_t zcap = reg_bound("zstd", chunk); if (zcap > out_cap) out_cap = zcap;
+  size_t lcap = reg_bound("lz4", chunk);  if (lcap > out_cap) out_cap = lcap;
+  size_t scap = snappy_max_compressed_size(chunk); if (scap > out_cap) out_cap = scap;
+  return out_cap;
+}
+
+static int is_all_zero(const unsigned char *p, size_t n) { return simd_is_zero(p, n); }
+
+/*
+ * Incompressibility pre-screen: a few strided sample blocks feed a byte
+ * histogram and a 4-byte repeat probe. High order-0 entropy with almost no
+ * repeats (media, encrypted or already-compressed data) goes straight to
+ * COPY instead of through every codec trial. The entropy estimate is also
+ * what a calibration profile classifies the chunk by.
+ */
+#define WARP_SCREEN_MIN    (64u * 1024u) /* smaller chunks are simply tried */
+#define WARP_SCREEN_BLOCKS 16
+#define WARP_SCREEN_BLOCK  4096u
+#define WARP_SCREEN_BITS   7.95          /* bits/byte */
+
+static int screen_chunk(const unsigned char *p, size_t n, double *bits) {
+  uint32_t hist[256];
+  uint32_t seen[4096];
+  if (n < WARP_SCREEN_MIN) { simd_histogram(p, n, hist); *bits = profile_entropy(hist, (double)n); return 0; }
+  memset(hist, 0, sizeof(hist));
+  memset(seen, 0, sizeof(seen));
+  const size_t step = (n - WARP_SCREEN_BLOCK) / (WARP_SCREEN_BLOCKS - 1);
+  size_t probes = 0, repeats = 0;
+  for (size_t b = 0; b < WARP_SCREEN_BLOCKS; b++) {
+    const unsigned char *blk = p + b * step;
+    simd_kernels()->histogram(blk, WARP_SCREEN_BLOCK, hist);
+    for (size_t i = 0; i + 4 <= WARP_SCREEN_BLOCK; i += 4) {
+      uint32_t v;
+      memcpy(&v, blk + i, 4);
+      uint32_t h = (v * 2654435761u) >> 20;
+      repeats += (seen[h] == v);
+      seen[h] = v;
+      probes++;
+    }
+  }
+  *bits = profile_entropy(hist, (double)WARP_SCREEN_BLOCKS * WARP_SCREEN_BLOCK);
+  if (repeats * 50 > probes) return 0; /* >2% repeated words: an LZ coder will find matches */
+  return *bits >= WARP_SCREEN_BITS;
+}
+
+/* Holes shorter than this stay inside their data chunk (read back as zeros). */
+#define WARP_HOLE_MIN (64u * 1024u)
+
+/*
+ * Cuts [start,total) into chunks on the usual chunk grid, additionally cut at
+ * the edges of holes the filesystem reports via SEEK_DATA/SEEK_HOLE. Hole
+ * pieces are flagged so they become ZERO entries without being read.
+ * `cut` gets n+1 offsets, `hole` n flags. Returns 0, or -1 on OOM.
+ */
+static int plan_chunks(int fd, uint64_t start, uint64_t total, uint32_t chunk,
+                       uint64_t **cut_out, uint8_t **hole_out, uint32_t *n_out) {
+  uint64_t *holes = NULL; /* [start,end) pairs */
+  size_t nh = 0, hcap = 0;
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+  for (off_t at = (off_t)start; (uint64_t)at < total; ) {
+    off_t data = lseek(fd, at, SEEK_DATA);
+    if (data < 0 && errno != ENXIO) break;          /* unsupported: treat all as data */
+    uint64_t hs = (uint64_t)at, he = data < 0 ? total : (uint64_t)data;
+    if (he > total) he = total;
+    if (he - hs >= WARP_HOLE_MIN) {
+      if (nh == hcap) {
+        size_t ncap = hcap ? hcap * 2 : 16;
+        uint64_t *nhv = (uint64_t*)realloc(holes, ncap * 2 * sizeof(*nhv));
+        if (!nhv) { free(holes); return -1; }
+        holes = nhv; hcap = ncap;
+      }
+      holes[2*nh] = hs; holes[2*nh+1] = he; nh++;
+    }
+    if (data < 0) break;
+    off_t next = lseek(fd, data, SEEK_HOLE);
+    if (next <= data) break;
+    at = next;
+  }
+  lseek(fd, 0, SEEK_SET);
+#else
+  (void)fd;
+#endif
+
+  /* each hole adds at most two cuts to the uniform grid, an unaligned start one */
+  size_t cap = (size_t)((total - start + chunk - 1) / chunk) + 2 * nh + 2;
+  uint64_t *cut = (uint64_t*)malloc(cap * sizeof(*cut));
+  uint8_t *hole = (uint8_t*)malloc(cap);
+  if (!cut || !hole) { free(cut); free(hole); free(holes); return -1; }
+
+  uint32_t n = 0;
+  size_t h = 0;
+  for (uint64_t p = start; p < total; ) {
+    uint64_t grid = (p / chunk + 1) * (uint64_t)chunk;
+    uint64_t end = grid < total ? grid : total;
+    int in_hole = 0;
+    if (h < nh && p >= holes[2*h]) {        /* inside hole h */
+      in_hole = 1;
+      if (holes[2*h+1] < end) end = holes[2*h+1];
+    } else if (h < nh && holes[2*h] < end) { /* hole starts within this chunk */
+      end = holes[2*h];
+    }
+    cut[n] = p; hole[n] = (uint8_t)in_hole; n++;
+    p = end;
+    if (h < nh && p >= holes[2*h+1]) h++;
+  }
+  cut[n] = total;
+  free(holes);
+  *cut_out = cut; *hole_out = hole; *n_out = n;
+  return 0;
+}
+
+/* Input reads: one file, or (archives) the member files back to back, each
+ * opened only for the reads that span it. Short reads are errors. */
+static ssize_t src_pread(int fd, const warp_member_t *mem, uint32_t nmem, void *buf, size_t len, uint64_t off) {
+  if (!mem) return wc_pread(fd, buf, len, off);
+  uint32_t lo = 0, hi = nmem; /* first member ending after off */
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    if (mem[mid].off + mem[mid].size <= off) lo = mid + 1; else hi = mid;
+  }
+  size_t done = 0;
+  for (uint32_t k = lo; k < nmem && done < len; k++) {
+    const uint64_t at = off + done - mem[k].off;
+    if (at >= mem[k].size) continue; /* empty */
+    const size_t want = (mem[k].size - at < len - done) ? (size_t)(mem[k].size - at) : len - done;
+    int f = open(mem[k].path, O_RDONLY);
+    if (f < 0) return -1;
+    ssize_t got = wc_pread(f, (unsigned char*)buf + done, want, at);
+    close(f);
+    if (got != (ssize_t)want) return -1; /* changed since it was listed */
+    done += want;
+  }
+  return (ssize_t)done;
+}
+
+/*
+ * Content-defined variant of plan_chunks (warp_opts_t.cdc): one sequential
+ * pass over the input (the mapping, or preads) places the cuts and, with
+ * xxHash, fingerprints every chunk with XXH3-128. dup[i] is the index of the
+ * first earlier chunk with the same fingerprint, or UINT32_MAX; those are
+ * stored as WARP_ALGO_DUP and never compressed. Holes are not special-cased
+ * here (zero chunks still become ZERO or DUP). Returns 0, -1 on OOM, -2 on a
+ * read error.
+ */
+static int plan_cdc(int fd, const warp_member_t *mem, uint32_t nmem, const unsigned char *map,
+                    uint64_t start, uint64_t total, uint32_t chunk,
+                    uint64_t **cut_out, uint8_t **hole_out, uint32_t **dup_out, uint32_t *n_out) {
+  cdc_t cdc;
+  cdc_init(&cdc, chunk);
+  const size_t cap = (size_t)((total - start) / (cdc.min ? cdc.min : 1)) + 2;
+  uint64_t *cut = (uint64_t*)malloc(cap * sizeof(*cut));
+  uint8_t *hole = (uint8_t*)calloc(cap, 1);
+  uint32_t *dup = (uint32_t*)malloc(cap * sizeof(*dup));
+  unsigned char *buf = map ? NULL : (unsigned char*)malloc(2 * (size_t)chunk);
+  if (!cut || !hole || !dup || (!map && !buf)) { free(cut); free(hole); free(dup); free(buf); return -1; }
+
+#ifdef HAVE_XXHASH
+  /* open-addressed fingerprint index, values are chunk index + 1 */
+  size_t slots = 64;
+  while (slots < 2 * cap) slots *= 2;
+  XXH128_hash_t *fp = (XXH128_hash_t*)malloc(cap * sizeof(*fp));
+  uint32_t *idx = (uint32_t*)calloc(slots, sizeof(*idx));
+  if (!fp || !idx) { free(fp); free(idx); free(cut); free(hole); free(dup); free(buf); return -1; }
+#endif
+
+  uint32_t n = 0;
+  uint64_t pos = start, have_off = start;
+  size_t have = 0; /* buf holds input [have_off, have_off + have) */
+  int rc = 0;
+  while (pos < total) {
+    const size_t want = (total - pos < cdc.max) ? (size_t)(total - pos) : cdc.max;
+    const unsigned char *p;
+    if (map) {
+      p = map + pos;
+    } else {
+      if (pos + want > have_off + have) { /* slide the window and top it up */
+        const size_t keep = (size_t)(have_off + have - pos);
+        memmove(buf, buf + (pos - have_off), keep);
+        const size_t get = (total - pos < 2 * (uint64_t)chunk ? (size_t)(total - pos) : 2 * (size_t)chunk) - keep;
+        if (src_pread(fd, mem, nmem, buf + keep, get, pos + keep) != (ssize_t)get) { rc = -2; break; }
+        have_off = pos; have = keep + get;
+      }
+      p = buf + (pos - have_off);
+    }
+    const size_t len = cdc_cut(&cdc, p, want);
+    cut[n] = pos;
+    dup[n] = UINT32_MAX;
+#ifdef HAVE_XXHASH
+    fp[n] = XXH3_128bits(p, len);
+    size_t h = (size_t)fp[n].low64 & (slots - 1);
+    for (; idx[h]; h = (h + 1) & (slots - 1)) {
+      const uint32_t k = idx[h] - 1;
+      if (XXH128_isEqual(fp[k], fp[n]) && cut[k + 1] - cut[k] == len) { dup[n] = k; break; }
+    }
+    if (!idx[h]) idx[h] = n + 1;
+#endif
+    n++;
+    cut[n] = pos += len;
+  }
+  cut[n] = total;
+
+#ifdef HAVE_XXHASH
+  free(fp); free(idx);
+#endif
+  free(buf);
+  if (rc) { free(cut); free(hole); free(dup); return rc; }
+  *cut_out = cut; *hole_out = hole; *dup_out = dup; *n_out = n;
+  return 0;
 }
 
 static double now_secs(void) {
@@ -49,6 +285,35 @@ static double now_secs(void) {
 
 /* ---------- per-chunk jobs ---------- */
 
+/* completion signal for windowed (streaming) scheduling */
+typedef struct {
+  pthread_mutex_t mtx;
+  pthread_cond_t  cv;
+} job_sync_t;
+
+static void job_sync_init(job_sync_t *s) {
+  pthread_mutex_init(&s->mtx, NULL);
+  pthread_cond_init(&s->cv, NULL);
+}
+
+static void job_sync_destroy(job_sync_t *s) {
+  pthread_mutex_destroy(&s->mtx);
+  pthread_cond_destroy(&s->cv);
+}
+
+static void job_sync_signal(job_sync_t *s, int *done) {
+  pthread_mutex_lock(&s->mtx);
+  *done = 1;
+  pthread_cond_broadcast(&s->cv);
+  pthread_mutex_unlock(&s->mtx);
+}
+
+static void job_sync_wait(job_sync_t *s, const int *done) {
+  pthread_mutex_lock(&s->mtx);
+  while (!*done) pthread_cond_wait(&s->cv, &s->mtx);
+  pthread_mutex_unlock(&s->mtx);
+}
+
 typedef struct {
   int fd;
   size_t offset, len;
@@ -60,34 +325,87 @@ typedef struct {
   bufpool_t *out_pool;
   size_t     out_cap;
 
+  const unsigned char *map; /* whole-input mapping (zero-copy), or NULL */
+  const warp_member_t *mem; /* archive: read these files back to back instead of fd */
+  uint32_t nmem;
+
   /* results */
-  unsigned char *in_buf;
+  unsigned char *in_buf;  /* preset by the caller when streaming (no pread) */
   unsigned char *comp;
   size_t comp_len;
   int out_algo;
   double secs;
+  int screened;           /* sent to COPY by the pre-screen, no trials run */
+  int auto_mode;          /* WARP_AUTO_*: how trials are scored */
+  size_t sample_bytes;    /* trial budget per codec, 0 = WARP_SAMPLE_DEFAULT */
+  const warp_profile_t *profile; /* auto mode: pick from calibration instead of trials */
+  const warp_dict_t *dict;       /* zstd compresses against this dictionary, or NULL */
+  size_t prefix_off, prefix_len; /* prefix mode: raw range of the group's first chunk (len 0 = none) */
+  const unsigned char *prefix;   /* that range, mapped or read into prefix_buf */
+  unsigned char *prefix_buf;
+  uint32_t ref;                  /* idx minus the prefix chunk's index */
+  int want_sum;                  /* WARP_CHK_XXH3: hash the input into sum */
+  uint64_t sum;
+  size_t trial_len[3];    /* per codec tried (WARP_ALGO_ZSTD..SNAPPY - 1), 0 = not tried;
+                             estimated full-chunk size when sampled */
+  double trial_mbps[3];
   int ok;
+
+  job_sync_t *sync;       /* windowed scheduling only */
+  int done;
 } c_job_t;
 
 typedef struct {
   int fd;
   uint32_t idx;
   warp_chunk_t ent;
+  const unsigned char *src; /* preloaded payload or mapping slice (no pread) */
+  const warp_dict_t *dict;  /* WARP_FLAG_DICT files: zstd chunks need it */
+  const unsigned char *prefix; /* WARP_ALGO_ZSTD_REF: raw data of the prefix chunk */
+  size_t prefix_len;
   bufpool_t *out_pool;
   unsigned char *buf;
   int ok;
+
+  job_sync_t *sync;
+  int done;
+
+  /* direct mode: the worker writes to out_fd at out_off and frees its buffer */
+  struct d_window *win;
+  int out_fd;
+  uint64_t out_off;
+  const unsigned char *zeros; /* ZERO chunks: source of zeros, NULL = leave a hole */
+  uint32_t slot;
+  const warp_chunk_t *deps;   /* prefix group: the entries after this one up to its last REF chunk */
+  uint32_t ndeps;
+  const uint64_t *sums;       /* WARP_CHK_XXH3 of this chunk and its deps (0 = unchecked), or NULL */
+  int hash;                   /* stream mode: hash the output into sum instead */
+  uint64_t sum;
+  int bad_sum;
+  const unsigned char *map;   /* input mapping for their payloads, or NULL */
+  uint64_t map_size;
 } d_job_t;
 
+/* free job slots of the direct-write decompressor */
+typedef struct d_window {
+  job_sync_t sync;
+  uint32_t  *free;
+  size_t     nfree;
+  int        failed;
+  uint32_t   bad_idx;
+  int        bad_sum;  /* the failure was a checksum mismatch */
+} d_window_t;
+
 /* ---------- codec trials ---------- */
 
 static size_t try_algo_zstd(const unsigned char *in, size_t in_len, int level,
                             unsigned char *out, size_t out_cap) {
-  return zstd_compress(out, out_cap, in, in_len, level);
+  return reg_compress("zstd", out, out_cap, in, in_len, level);
 }
 
 static size_t try_algo_lz4(const unsigned char *in, size_t in_len,
                            unsigned char *out, size_t out_cap) {
-  return wc_lz4_compress(out, out_cap, in, in_len);
+  return reg_compress("lz4", out, out_cap, in, in_len, 0);
 }
 
 static size_t try_algo_snappy(const unsigned char *in, size_t in_len,
@@ -95,20 +413,78 @@ static size_t try_algo_snappy(const unsigned char *in, size_t in_len,
   return wc_snappy_compress(out, out_cap, in, in_len);
 }
 
+static size_t run_algo(int algo, const unsigned char *in, size_t in_len, int level,
+                       unsigned char *out, size_t out_cap) {
+  switch (algo) {
+    case WARP_ALGO_ZSTD:   return try_algo_zstd  (in, in_len, level, out, out_cap);
+    case WARP_ALGO_LZ4:    return try_algo_lz4   (in, in_len, out, out_cap);
+    case WARP_ALGO_SNAPPY: return try_algo_snappy(in, in_len, out, out_cap);
+    default:               return 0;
+  }
+}
+
+/* run_algo for a job: zstd goes through the group prefix or the file's dictionary */
+static size_t job_algo(const c_job_t *j, int algo, const unsigned char *in, size_t in_len, unsigned char *out) {
+  if (algo == WARP_ALGO_ZSTD && j->prefix)
+    return warp_prefix_compress(out, j->out_cap, in, in_len, j->prefix, j->prefix_len, j->level);
+  if (algo == WARP_ALGO_ZSTD && j->dict) return warp_dict_compress(j->dict, out, j->out_cap, in, in_len);
+  return run_algo(algo, in, in_len, j->level, out, j->out_cap);
+}
+
+/* Auto-mode trial budget per codec, split over strided sub-blocks. */
+#define WARP_SAMPLE_DEFAULT (1u << 20)
+#define WARP_SAMPLE_BLOCKS  4
+
+static int score_pick_algo(int mode, size_t in_len,
+                           size_t z_len, double z_mbps,
+                           size_t l_len, double l_mbps,
+                           size_t s_len, double s_mbps);
+
+/* Codec for a chunk of the given entropy from the calibrated numbers; 0 if
+ * the profile covers no codec. */
+static int profile_pick(const warp_profile_t *p, double bits, int mode, int level) {
+  const size_t unit = 1u << 20;
+  size_t len[3] = { 0, 0, 0 };
+  double mbps[3] = { 0, 0, 0 };
+  int any = 0;
+  for (int a = WARP_ALGO_ZSTD; a <= WARP_ALGO_SNAPPY; a++) {
+    const profile_ent_t *e = profile_lookup(p, bits, a, a == WARP_ALGO_ZSTD ? level : 0);
+    if (!e) continue;
+    len[a - 1] = (size_t)(e->ratio * (double)unit) + 1;
+    mbps[a - 1] = e->mbps;
+    any = 1;
+  }
+  return any ? score_pick_algo(mode, unit, len[0], mbps[0], len[1], mbps[1], len[2], mbps[2]) : 0;
+}
+
 /* ---------- worker bodies ---------- */
 
 static void do_compress(void *arg) {
   c_job_t *j = (c_job_t*)arg;
+  const int preloaded = (j->in_buf != NULL);
+  const unsigned char *src = NULL;
 
-  j->in_buf = (unsigned char*)pool_acquire(j->in_pool);
-  unsigned char *out = (unsigned char*)pool_acquire(j->out_pool);
-  if (!j->in_buf || !out) { j->ok = 0; return; }
+  /* the window never has more jobs than buffers, so these only wait on stragglers */
+  if (!preloaded && !j->map) j->in_buf = (unsigned char*)pool_acquire_wait(j->in_pool, -1);
+  unsigned char *out = (unsigned char*)pool_acquire_wait(j->out_pool, -1);
+  if ((!j->in_buf && !j->map) || !out) { pool_release(j->out_pool, out); j->ok = 0; return; }
 
-  ssize_t r = wc_pread(j->fd, j->in_buf, j->len, (uint64_t)j->offset);
-  if (r != (ssize_t)j->len) { j->ok = 0; return; }
+  if (j->map) {
+    src = j->map + j->offset; /* codecs read the page cache directly */
+  } else {
+    if (!preloaded) {
+      ssize_t r = src_pread(j->fd, j->mem, j->nmem, j->in_buf, j->len, (uint64_t)j->offset);
+      if (r != (ssize_t)j->len) { pool_release(j->out_pool, out); j->ok = 0; return; }
+    }
+    src = j->in_buf;
+  }
+#ifdef HAVE_XXHASH
+  if (j->want_sum) j->sum = XXH3_64bits(src, j->len); /* while the data is hot */
+#endif
 
   /* ZERO fast-path */
-  if (is_all_zero(j->in_buf, j->len)) {
+  if (is_all_zero(src, j->len)) {
+    pool_release(j->out_pool, out);
     j->comp = NULL;
     j->comp_len = 0;
     j->out_algo = WARP_ALGO_ZERO;
@@ -117,59 +493,103 @@ static void do_compress(void *arg) {
     return;
   }
 
-  /* candidate set */
-  int cands[4]; int cc = 0;
-  if (j->prefer_algo == 0) {
-    cands[cc++] = WARP_ALGO_ZSTD;
-    cands[cc++] = WARP_ALGO_LZ4;
-    cands[cc++] = WARP_ALGO_SNAPPY;
-  } else {
-    cands[cc++] = j->prefer_algo;
-  }
-
-  double best_score = -1e300;
-  size_t best_len = 0;
-  int    best_algo = WARP_ALGO_COPY;
-  double best_secs = 0.0;
-
-  for (int k = 0; k < cc; k++) {
-    int algo = cands[k];
-    size_t got = 0;
-    double t0 = now_secs();
-    if (algo == WARP_ALGO_ZSTD)       got = try_algo_zstd  (j->in_buf, j->len, j->level, out, j->out_cap);
-    else if (algo == WARP_ALGO_LZ4)   got = try_algo_lz4   (j->in_buf, j->len, out, j->out_cap);
-    else if (algo == WARP_ALGO_SNAPPY)got = try_algo_snappy(j->in_buf, j->len, out, j->out_cap);
-    else if (algo == WARP_ALGO_COPY)  { memcpy(out, j->in_buf, j->len); got = j->len; }
-    double dt = now_secs() - t0;
-    if (!got) continue;
-    double mbps = dt > 0 ? (j->len / (1024.0 * 1024.0)) / dt : 0.0;
-    if (mbps > best_score) {
-      best_score = mbps;
-      best_len   = got;
-      best_algo  = algo;
-      best_secs  = dt;
+  /* order-0 entropy cannot see repeats of the group prefix */
+  double bits = 0.0;
+  if (screen_chunk(src, j->len, &bits) && !j->prefix_len) {
+    memcpy(out, src, j->len);
+    j->comp = out;
+    j->comp_len = j->len;
+    j->out_algo = WARP_ALGO_COPY;
+    j->secs = 0.0;
+    j->screened = 1;
+    j->ok = 1;
+    return;
+  }
+
+  if (j->prefix_len && j->map) {
+    j->prefix = j->map + j->prefix_off;
+  } else if (j->prefix_len) {
+    /* in_pool holds two buffers per job in prefix mode */
+    j->prefix_buf = (unsigned char*)pool_acquire_wait(j->in_pool, -1);
+    if (j->prefix_buf && src_pread(j->fd, j->mem, j->nmem, j->prefix_buf, j->prefix_len, (uint64_t)j->prefix_off) == (ssize_t)j->prefix_len)
+      j->prefix = j->prefix_buf; /* else compress without it */
+  }
+
+  double t0 = now_secs();
+  int    algo = j->prefer_algo;
+  size_t got  = 0;
+
+  if (!algo && j->profile) algo = profile_pick(j->profile, bits, j->auto_mode, j->level);
+
+  if (algo == 0) {
+    /*
+     * Trial: each codec compresses WARP_SAMPLE_BLOCKS strided sub-blocks
+     * (sample_bytes in total) and ratio/MB/s are extrapolated to the chunk;
+     * small chunks are tried whole. The winner by the mode-aware score then
+     * compresses the chunk once.
+     */
+    const size_t budget = j->sample_bytes ? j->sample_bytes : WARP_SAMPLE_DEFAULT;
+    const int sampled = budget < j->len;
+    const size_t blk  = sampled ? budget / WARP_SAMPLE_BLOCKS : j->len;
+    const size_t nblk = sampled ? WARP_SAMPLE_BLOCKS : 1;
+    const size_t step = sampled ? (j->len - blk) / (WARP_SAMPLE_BLOCKS - 1) : 0;
+    int out_algo = 0; /* codec whose full-chunk bytes are currently in `out` */
+    for (int c = WARP_ALGO_ZSTD; c <= WARP_ALGO_SNAPPY; c++) {
+      size_t clen = 0;
+      double ts = now_secs();
+      for (size_t b = 0; b < nblk; b++) {
+        size_t r = job_algo(j, c, src + b * step, blk, out);
+        if (!r) { clen = 0; break; }
+        clen += r;
+      }
+      double dt = now_secs() - ts;
+      if (!clen) continue;
+      if (!sampled) out_algo = c;
+      j->trial_len[c - 1]  = sampled ? (size_t)((double)clen * (double)j->len / (double)(nblk * blk)) + 1 : clen;
+      j->trial_mbps[c - 1] = dt > 0 ? ((double)(nblk * blk) / (1024.0 * 1024.0)) / dt : 0.0;
     }
+    algo = score_pick_algo(j->auto_mode, j->len,
+                           j->trial_len[0], j->trial_mbps[0],
+                           j->trial_len[1], j->trial_mbps[1],
+                           j->trial_len[2], j->trial_mbps[2]);
+    if (!j->trial_len[algo - 1]) algo = 0;                    /* every codec failed */
+    else if (out_algo == algo) got = j->trial_len[algo - 1]; /* whole-chunk trial already in `out` */
+    t0 = now_secs();
+  }
+  if (algo && !got) got = job_algo(j, algo, src, j->len, out);
+  double dt = now_secs() - t0;
+  if (j->prefer_algo && algo >= WARP_ALGO_ZSTD && algo <= WARP_ALGO_SNAPPY && got) {
+    j->trial_len[algo - 1]  = got;
+    j->trial_mbps[algo - 1] = dt > 0 ? ((double)j->len / (1024.0 * 1024.0)) / dt : 0.0;
   }
 
   /* COPY fallback if not much gain or all failed */
-  if (best_len == 0 || best_len >= j->len - (j->len >> 6)) {
-    memcpy(out, j->in_buf, j->len);
-    best_algo = WARP_ALGO_COPY;
-    best_len  = j->len;
-    best_secs = 0.0;
+  if (!algo || got == 0 || got >= j->len - (j->len >> 6)) {
+    memcpy(out, src, j->len);
+    algo = WARP_ALGO_COPY;
+    got  = j->len;
+    dt   = 0.0;
   }
 
+  pool_release(j->in_pool, j->prefix_buf);
+  j->prefix_buf = NULL;
   j->comp     = out;
-  j->comp_len = best_len;
-  j->out_algo = best_algo;
-  j->secs     = best_secs;
+  j->comp_len = got;
+  j->out_algo = (algo == WARP_ALGO_ZSTD && j->prefix) ? WARP_ALGO_ZSTD_REF : algo;
+  j->secs     = dt;
   j->ok       = 1;
 }
 
 static void do_decompress(void *arg) {
   d_job_t *j = (d_job_t*)arg;
 
-  j->buf = (unsigned char*)pool_acquire(j->out_pool);
+  if (j->win && j->ent.algo == WARP_ALGO_ZERO) {
+    /* the output was pre-sized, so a hole already reads back as zeros */
+    j->ok = !j->zeros || wc_pwrite(j->out_fd, j->zeros, j->ent.orig_len, j->out_off) == (ssize_t)j->ent.orig_len;
+    return;
+  }
+
+  j->buf = (unsigned char*)pool_acquire_wait(j->out_pool, -1);
   if (!j->buf) { j->ok = 0; return; }
 
   if (j->ent.algo == WARP_ALGO_ZERO) {
@@ -177,26 +597,106 @@ static void do_decompress(void *arg) {
     j->ok = 1; return;
   }
 
-  unsigned char *comp = (unsigned char*)malloc(j->ent.comp_len);
-  if (!comp) { j->ok = 0; return; }
-  ssize_t r = wc_pread(j->fd, comp, j->ent.comp_len, j->ent.offset);
-  if (r != (ssize_t)j->ent.comp_len) { free(comp); j->ok = 0; return; }
+  const unsigned char *comp = j->src;
+  unsigned char *owned = NULL;
+  if (!comp) {
+    owned = (unsigned char*)malloc(j->ent.comp_len);
+    if (!owned) { j->ok = 0; return; }
+    ssize_t r = wc_pread(j->fd, owned, j->ent.comp_len, j->ent.offset);
+    if (r != (ssize_t)j->ent.comp_len) { free(owned); j->ok = 0; return; }
+    comp = owned;
+  }
 
   size_t got = 0;
   switch (j->ent.algo) {
     case WARP_ALGO_COPY:   memcpy(j->buf, comp, j->ent.orig_len); got = j->ent.orig_len; break;
-    case WARP_ALGO_ZSTD:   got = zstd_decompress(j->buf, j->ent.orig_len, comp, j->ent.comp_len); break;
-    case WARP_ALGO_LZ4:    got = wc_lz4_decompress(j->buf, j->ent.orig_len, comp, j->ent.comp_len); break;
+    case WARP_ALGO_ZSTD:   got = j->dict ? warp_dict_decompress(j->dict, j->buf, j->ent.orig_len, comp, j->ent.comp_len)
+                                     : reg_decompress("zstd", j->buf, j->ent.orig_len, comp, j->ent.comp_len); break;
+    case WARP_ALGO_LZ4:    got = reg_decompress("lz4", j->buf, j->ent.orig_len, comp, j->ent.comp_len); break;
     case WARP_ALGO_SNAPPY: got = wc_snappy_decompress(j->buf, j->ent.orig_len, comp, j->ent.comp_len); break;
+    case WARP_ALGO_ZSTD_REF:
+      got = j->prefix ? warp_prefix_decompress(j->buf, j->ent.orig_len, comp, j->ent.comp_len, j->prefix, j->prefix_len) : 0;
+      break;
     default: got = 0; break;
   }
-  free(comp);
+  free(owned);
 
-  if (got != j->ent.orig_len) { j->ok = 0; return; }
-  j->ok = 1;
+  j->ok = (got == j->ent.orig_len);
+#ifdef HAVE_XXHASH
+  if (j->ok && (j->hash || (j->sums && j->sums[0]))) {
+    j->sum = XXH3_64bits(j->buf, j->ent.orig_len);
+    if (j->sums && j->sums[0] && j->sum != j->sums[0]) { j->ok = 0; j->bad_sum = 1; }
+  }
+#endif
+  if (j->win) {
+    if (j->ok) j->ok = wc_pwrite(j->out_fd, j->buf, j->ent.orig_len, j->out_off) == (ssize_t)j->ent.orig_len;
+    if (!j->ndeps) { pool_release(j->out_pool, j->buf); j->buf = NULL; } /* else the group's prefix */
+  }
 }
 
-/* ---------- simple policy combiner (warm-up) ---------- */
+/* Direct mode, prefix group: the REF chunks after j, decoded against j's
+ * output still in j->buf (NULL for a ZERO chunk). Members that fell back to
+ * another codec are jobs of their own and only skipped here. Needs a second
+ * buffer. */
+static int decode_group_deps(d_job_t *j) {
+  const size_t plen = j->ent.orig_len;
+  if (!j->buf) {
+    if (!(j->buf = (unsigned char*)pool_acquire_wait(j->out_pool, -1))) return 0;
+    memset(j->buf, 0, plen);
+  }
+  unsigned char *dst = (unsigned char*)pool_acquire_wait(j->out_pool, -1);
+  if (!dst) return 0;
+  uint64_t off = j->out_off + plen;
+  int ok = 1;
+  for (uint32_t k = 0; ok && k < j->ndeps; k++) {
+    const warp_chunk_t *e = &j->deps[k];
+    if (e->algo != WARP_ALGO_ZSTD_REF || e->ref != k + 1) { off += e->orig_len; continue; }
+    const unsigned char *comp = NULL;
+    unsigned char *owned = NULL;
+    if (j->map && e->offset + e->comp_len <= j->map_size) comp = j->map + e->offset;
+    else if ((owned = (unsigned char*)malloc(e->comp_len)) &&
+             wc_pread(j->fd, owned, e->comp_len, e->offset) == (ssize_t)e->comp_len) comp = owned;
+    ok = comp && warp_prefix_decompress(dst, e->orig_len, comp, e->comp_len, j->buf, plen) == e->orig_len;
+    free(owned);
+#ifdef HAVE_XXHASH
+    if (ok && j->sums && j->sums[k + 1] && XXH3_64bits(dst, e->orig_len) != j->sums[k + 1]) { ok = 0; j->bad_sum = 1; }
+#endif
+    ok = ok && wc_pwrite(j->out_fd, dst, e->orig_len, off) == (ssize_t)e->orig_len;
+    off += e->orig_len;
+  }
+  pool_release(j->out_pool, dst);
+  return ok;
+}
+
+static void do_compress_win(void *arg) {
+  c_job_t *j = (c_job_t*)arg;
+  do_compress(j);
+  job_sync_signal(j->sync, &j->done);
+}
+
+static void do_decompress_win(void *arg) {
+  d_job_t *j = (d_job_t*)arg;
+  do_decompress(j);
+  job_sync_signal(j->sync, &j->done);
+}
+
+static void do_decompress_direct(void *arg) {
+  d_job_t *j = (d_job_t*)arg;
+  d_window_t *w = j->win;
+  do_decompress(j);
+  if (j->ndeps) {
+    if (j->ok) j->ok = decode_group_deps(j);
+    pool_release(j->out_pool, j->buf);
+    j->buf = NULL;
+  }
+  pthread_mutex_lock(&w->sync.mtx);
+  if (!j->ok && !w->failed) { w->failed = 1; w->bad_idx = j->idx; w->bad_sum = j->bad_sum; }
+  w->free[w->nfree++] = j->slot;
+  pthread_cond_broadcast(&w->sync.cv);
+  pthread_mutex_unlock(&w->sync.mtx);
+}
+
+/* ---------- simple policy combiner ---------- */
 
 static int score_pick_algo(int mode, size_t in_len,
                            size_t z_len, double z_mbps,
@@ -220,45 +720,636 @@ static int score_pick_algo(int mode, size_t in_len,
   return best_algo;
 }
 
-/* ---------- public API ---------- */
+/* ---------- adaptive codec choice ---------- */
 
-int warp_compress_file(const char *in_path, const char *out_path, const warp_opts_t *opt) {
+/*
+ * Explore/exploit over the three codecs. The warm-up chunks try every codec;
+ * after that each chunk uses the best-scoring codec, except that every
+ * WARP_EXPLORE_EVERY-th chunk re-runs all of them to refresh the other arms.
+ * Per-codec ratio and MB/s are exponentially weighted, so a shift in the
+ * data moves the choice within a few chunks; a sudden ratio jump on the
+ * exploited codec schedules a probe right away.
+ */
+#define WARP_EXPLORE_EVERY 16
+#define WARP_EWMA_ALPHA    0.25
+#define WARP_DRIFT         0.15  /* ratio change that triggers an early probe */
+
+typedef struct {
+  int      mode;                 /* WARP_AUTO_* */
+  double   mbps[3], ratio[3];    /* indexed by WARP_ALGO_ZSTD..SNAPPY - 1 */
+  int      have[3];
+  int      current;              /* codec for exploit chunks, 0 = none yet */
+  uint32_t since_probe;
+  int      probe_next;
+  uint32_t probes, switches;
+} codec_bandit_t;
+
+static void bandit_init(codec_bandit_t *b, int mode) {
+  memset(b, 0, sizeof(*b));
+  b->mode = mode;
+}
+
+/* prefer_algo for the next chunk: 0 = probe every codec */
+static int bandit_choose(codec_bandit_t *b) {
+  if (!b->current || b->probe_next || ++b->since_probe >= WARP_EXPLORE_EVERY) {
+    b->probe_next = 0;
+    b->since_probe = 0;
+    b->probes++;
+    return 0;
+  }
+  return b->current;
+}
+
+/* Feeds a finished chunk's trial measurements, in chunk order. */
+static void bandit_update(codec_bandit_t *b, const c_job_t *j) {
+  int measured = 0;
+  for (int k = 0; k < 3; k++) {
+    if (!j->trial_len[k]) continue;
+    double r = (double)j->trial_len[k] / (double)j->len;
+    if (!b->have[k]) { b->ratio[k] = r; b->mbps[k] = j->trial_mbps[k]; b->have[k] = 1; }
+    else {
+      if (j->prefer_algo && fabs(r - b->ratio[k]) > WARP_DRIFT) b->probe_next = 1;
+      b->ratio[k] += WARP_EWMA_ALPHA * (r - b->ratio[k]);
+      b->mbps[k]  += WARP_EWMA_ALPHA * (j->trial_mbps[k] - b->mbps[k]);
+    }
+    measured = 1;
+  }
+  if (!measured) return;
+  const size_t unit = 1u << 20;
+  int best = score_pick_algo(b->mode, unit,
+                             b->have[0] ? (size_t)(b->ratio[0] * (double)unit) + 1 : 0, b->mbps[0],
+                             b->have[1] ? (size_t)(b->ratio[1] * (double)unit) + 1 : 0, b->mbps[1],
+                             b->have[2] ? (size_t)(b->ratio[2] * (double)unit) + 1 : 0, b->mbps[2]);
+  if (b->current && best != b->current) b->switches++;
+  b->current = best;
+}
+
+/* Auto mode only: the calibration profile from opt->profile or the default
+ * location. Returns 1 if one was loaded into p. */
+static int load_profile(const warp_opts_t *opt, warp_profile_t *p) {
+  char path[4096];
+  if (opt->algo || (opt->profile && !*opt->profile)) return 0;
+  if (opt->profile) snprintf(path, sizeof(path), "%s", opt->profile);
+  else if (profile_default_path(path, sizeof(path)) != 0) return 0;
+  if (profile_load(path, p) != 0) {
+    if (opt->profile) fprintf(stderr, "profile %s unreadable, falling back to trials\n", path);
+    return 0;
+  }
+  if (opt->verbose) fprintf(stderr, "auto mode: using profile %s\n", path);
+  return 1;
+}
+
+/* opt->dict for compression at `level`: 0 with *out set (NULL when there is
+ * none or only non-zstd codecs can run), -1 if it cannot be used. */
+static int open_dict(const warp_opts_t *opt, int level, warp_dict_t **out) {
+  *out = NULL;
+  if (!opt->dict || !*opt->dict || opt->algo == WARP_ALGO_LZ4 || opt->algo == WARP_ALGO_SNAPPY) return 0;
+  if (!(*out = warp_dict_load(opt->dict, level))) { fprintf(stderr, "cannot use dictionary %s\n", opt->dict); return -1; }
+  if (opt->verbose) fprintf(stderr, "zstd dictionary %s (id %u)\n", opt->dict, warp_dict_id(*out));
+  return 0;
+}
+
+/* ---------- trailers ---------- */
+
+/* Appends WIX (if do_idx), WCHK (whole-file digest, else per-chunk sums if
+ * given) and the footer at `pos`. Returns bytes written, or 0 on error. */
+static uint64_t write_trailers(FILE *fout, uint64_t pos, const warp_chunk_t *table, uint32_t n,
+                               int do_idx, const unsigned long long *digest, const uint64_t *sums,
+                               const void *man, size_t man_len, uint64_t prev_ftr) {
+  uint64_t wix_off = 0, chk_off = 0, start = pos;
+  int ok = 1;
+
+  if (do_idx) {
+    wix_off = pos;
+    wix_header_t wh = { WIX_MAGIC, n };
+    ok &= fwrite(&wh, sizeof(wh), 1, fout) == 1;
+    for (uint32_t i = 0; i < n; i++) {
+      wix_entry_v1_t e;
+      e.payload_off = table[i].offset;
+      e.orig_len    = table[i].orig_len;
+      e.comp_len    = table[i].comp_len;
+      e.algo        = table[i].algo;
+      memset(e._pad, 0, sizeof(e._pad));
+      e.ref         = table[i].ref;
+      ok &= fwrite(&e, sizeof(e), 1, fout) == 1;
+    }
+    uint32_t crc0 = 0;
+    ok &= fwrite(&crc0, 4, 1, fout) == 1;
+    pos += sizeof(wh) + (uint64_t)n * sizeof(wix_entry_v1_t) + 4;
+  }
+
+  if (digest) {
+    chk_off = pos;
+    wchk_header_t ch = { WCHK_MAGIC, WARP_CHK_XXH64, 8, {0,0} };
+    ok &= fwrite(&ch, sizeof(ch), 1, fout) == 1;
+    ok &= fwrite(digest, 8, 1, fout) == 1;
+    pos += sizeof(ch) + 8;
+  } else if (sums) {
+    chk_off = pos;
+    wchk_header_t ch = { WCHK_MAGIC, WARP_CHK_XXH3, 8, {0,0} };
+    ok &= fwrite(&ch, sizeof(ch), 1, fout) == 1;
+    ok &= fwrite(&n, sizeof(n), 1, fout) == 1;
+    ok &= fwrite(sums, sizeof(*sums), n, fout) == n;
+    pos += sizeof(ch) + sizeof(n) + (uint64_t)n * sizeof(*sums);
+  }
+
+  wftr_footer_t ft = { .magic = WFTR_MAGIC, .flags = 0, .wix_off = wix_off, .chk_off = chk_off };
+  if (man || prev_ftr) { /* archive manifest / append chain, found through the footer extension */
+    wftr_ext_t ext;
+    memset(&ext, 0, sizeof(ext));
+    ext.man_off  = man ? pos : 0;
+    ext.prev_ftr = prev_ftr;
+    if (man) ok &= fwrite(man, man_len, 1, fout) == 1;
+    ok &= fwrite(&ext, sizeof(ext), 1, fout) == 1;
+    pos += (man ? man_len : 0) + sizeof(ext);
+    ft.flags |= WFTR_FLAG_EXT;
+  }
+  ok &= fwrite(&ft, sizeof(ft), 1, fout) == 1;
+  pos += sizeof(ft);
+  return ok ? pos - start : 0;
+}
+
+#ifdef HAVE_XXHASH
+static void xxh_update_zeros(XXH64_state_t *st, size_t n) {
+  static const unsigned char zeros[4096];
+  while (n) { size_t k = n < sizeof(zeros) ? n : sizeof(zeros); XXH64_update(st, zeros, k); n -= k; }
+}
+#endif
+
+/* ---------- streaming (non-seekable) paths ---------- */
+
+/*
+ * Compresses a pipe into the WARP_FLAG_STREAM layout without seeking. The
+ * main thread reads chunks, workers compress them and finished chunks are
+ * written in order; at most threads*2 chunks are in flight, so memory is
+ * bounded by the window and not the input size. In auto mode the first
+ * `warmup` chunks run all candidates and the window drains once to lock.
+ */
+static int compress_stream(int fd_in, FILE *fout, const warp_opts_t *opt) {
   const int threads   = opt->threads > 0 ? opt->threads : 1;
   const int level     = opt->level   > 0 ? opt->level   : 1;
   const int prefer    = opt->algo; /* 0=auto */
-  const int do_idx    = opt->do_index;
-  const int do_chk    = opt->chk_kind;
-  const int auto_mode = opt->auto_mode;
   const int warmup    = (opt->auto_lock > 0 ? opt->auto_lock : 4);
+  const uint32_t chunk = opt->chunk_bytes ? (uint32_t)opt->chunk_bytes : (uint32_t)WARPC_DEFAULT_CHUNK_KIB * 1024u;
+  const size_t out_cap = chunk_out_cap(chunk);
+  const size_t depth   = (size_t)threads * WARP_WINDOW_PER_THREAD;
+
+  bufpool_t *in_pool  = pool_create(depth, chunk);
+  bufpool_t *out_pool = pool_create(depth, out_cap);
+  c_job_t   *jobs     = (c_job_t*)calloc(depth, sizeof(*jobs));
+  tp_t      *tp       = (in_pool && out_pool && jobs) ? tp_create((size_t)threads) : NULL;
+  if (!tp) {
+    fprintf(stderr, "pool OOM\n");
+    if (in_pool)  pool_destroy(in_pool);
+    if (out_pool) pool_destroy(out_pool);
+    free(jobs);
+    return 1;
+  }
+  job_sync_t sync;
+  job_sync_init(&sync);
 
-  size_t total = fsize(in_path);
-  if (!total) { fprintf(stderr, "input not found or empty\n"); return 1; }
+#ifdef HAVE_XXHASH
+  XXH64_state_t *st = NULL;
+  if (opt->chk_kind == WARP_CHK_XXH64) { st = XXH64_createState(); XXH64_reset(st, 0); }
+  const int want_sum = opt->chk_kind == WARP_CHK_XXH3;
+#else
+  const int want_sum = 0;
+#endif
 
-  uint32_t chunk = opt->chunk_bytes ? (uint32_t)opt->chunk_bytes : warp_pick_chunk_size(total);
-  uint32_t n = (uint32_t)((total + chunk - 1) / chunk);
+  warp_header_t hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.magic      = WARP_MAGIC;
+  hdr.version    = WARP_VER;
+  hdr.base_algo  = (uint8_t)(prefer ? prefer : WARP_ALGO_ZSTD);
+  hdr.flags      = WARP_FLAG_STREAM;
+  hdr.chunk_size = chunk;
+  warp_dict_t *dict = NULL;
+  int rc = open_dict(opt, level, &dict) == 0 ? 0 : 1;
+  if (dict) hdr.flags |= WARP_FLAG_DICT;
+
+  warp_chunk_t *table = NULL;
+  uint64_t *sums = NULL; /* WARP_CHK_XXH3, hashed by the workers */
+  uint32_t n = 0, cap = 0;
+  uint64_t pos = sizeof(hdr), total = 0, comp_total = 0;
+  uint32_t issued = 0, written = 0, n_screened = 0;
+  warp_profile_t prof;
+  const int profiled = load_profile(opt, &prof);
+  int ready = prefer != 0 || profiled; /* auto mode: warm-up results are in */
+  int eof = 0;
+  codec_bandit_t bd;
+  bandit_init(&bd, opt->auto_mode);
+
+  if (!rc && (fwrite(&hdr, sizeof(hdr), 1, fout) != 1 || (dict && warp_dict_fwrite(fout, dict) != 0))) { perror("write hdr"); rc = 2; }
+  pos += warp_dict_block_size(dict);
+
+  while (!rc) {
+    /* refill; in auto mode hold chunks past the warm-up until the algo is locked */
+    while (!eof && issued - written < depth && (ready || issued < (uint32_t)warmup)) {
+      c_job_t *j = &jobs[issued % depth];
+      memset(j, 0, sizeof(*j));
+      j->in_buf = (unsigned char*)pool_acquire_wait(in_pool, -1);
+      if (!j->in_buf) { fprintf(stderr, "pool exhausted\n"); rc = 3; break; }
+      ssize_t r = read_upto(fd_in, j->in_buf, chunk);
+      if (r <= 0) {
+        if (r < 0) { perror("read in"); rc = 2; }
+        pool_release(in_pool, j->in_buf);
+        eof = 1; break;
+      }
+      j->fd = -1; j->offset = (size_t)total; j->len = (size_t)r;
+      j->prefer_algo = prefer || profiled ? prefer : (issued < (uint32_t)warmup ? 0 : bandit_choose(&bd));
+      j->auto_mode = opt->auto_mode; j->sample_bytes = opt->sample_bytes;
+      j->profile = profiled ? &prof : NULL;
+      j->dict = dict;
+      j->level = level; j->idx = issued; j->want_sum = want_sum;
+      j->in_pool = in_pool; j->out_pool = out_pool; j->out_cap = out_cap;
+      j->sync = &sync;
+      total += (uint64_t)r;
+      if (tp_submit(tp, do_compress_win, j) != 0) { pool_release(in_pool, j->in_buf); rc = 3; break; }
+      issued++;
+    }
+    if (rc || written == issued) break;
+
+    c_job_t *j = &jobs[written % depth];
+    job_sync_wait(&sync, &j->done);
+    if (!j->ok) { fprintf(stderr, "compress chunk %u failed\n", written); rc = 2; break; }
+
+    if (n == cap) {
+      uint32_t ncap = cap ? cap * 2 : 256;
+      warp_chunk_t *nt = (warp_chunk_t*)realloc(table, ncap * sizeof(*nt));
+      if (nt) table = nt;
+      uint64_t *ns = want_sum ? (uint64_t*)realloc(sums, ncap * sizeof(*ns)) : NULL;
+      if (ns) sums = ns;
+      if (!nt || (want_sum && !ns)) { rc = 3; break; }
+      cap = ncap;
+    }
+    if (want_sum) sums[n] = j->out_algo == WARP_ALGO_ZERO ? 0 : j->sum;
+    warp_chunk_t *e = &table[n++];
+    memset(e, 0, sizeof(*e));
+    e->orig_len = (uint32_t)j->len;
+    e->comp_len = (uint32_t)j->comp_len;
+    e->offset   = pos + sizeof(*e);
+    e->algo     = (uint8_t)j->out_algo;
+
+    int wok = fwrite(e, sizeof(*e), 1, fout) == 1;
+    pos += sizeof(*e);
+    if (j->out_algo != WARP_ALGO_ZERO) {
+      wok &= fwrite(j->comp, j->comp_len, 1, fout) == 1;
+      pos += j->comp_len;
+      comp_total += j->comp_len;
+      pool_release(out_pool, j->comp);
+    }
+#ifdef HAVE_XXHASH
+    if (st) XXH64_update(st, j->in_buf, j->len);
+#endif
+    pool_release(in_pool, j->in_buf);
+    if (!wok) { perror("fwrite"); written++; rc = 2; break; }
 
-  int fd_in = open(in_path, O_RDONLY);
-  if (fd_in < 0) { perror("open in"); return 1; }
-  wc_advise_sequential(fd_in);
+    if (!prefer && !profiled) bandit_update(&bd, j);
+    n_screened += (uint32_t)j->screened;
+    written++;
+    if (!ready && (written == (uint32_t)warmup || (eof && written == issued))) ready = 1;
+  }
 
-  FILE *fout = fopen(out_path, "wb+");
-  if (!fout) { perror("fopen out"); close(fd_in); return 1; }
+  /* drain anything still in flight (error paths) */
+  for (; written < issued; written++) {
+    c_job_t *j = &jobs[written % depth];
+    job_sync_wait(&sync, &j->done);
+    if (j->ok && j->comp) pool_release(out_pool, j->comp);
+    pool_release(in_pool, j->in_buf);
+  }
 
-  /* output cap = max bound among codecs for a single chunk */
-  size_t out_cap = chunk;
-  size_t zcap = zstd_max_compressed_size(chunk); if (zcap > out_cap) out_cap = zcap;
-  size_t lcap = lz4_max_compressed_size(chunk);  if (lcap > out_cap) out_cap = lcap;
-  size_t scap = snappy_max_compressed_size(chunk); if (scap > out_cap) out_cap = scap;
+  if (!rc) {
+    warp_chunk_t term;
+    memset(&term, 0, sizeof(term));
+    if (fwrite(&term, sizeof(term), 1, fout) != 1) { perror("write terminator"); rc = 2; }
+    pos += sizeof(term);
+  }
+
+  unsigned long long digest = 0, *dp = NULL;
+#ifdef HAVE_XXHASH
+  if (st) { digest = XXH64_digest(st); dp = &digest; XXH64_freeState(st); }
+#else
+  (void)digest;
+#endif
+  /* the WIX trailer is the chunk table of the stream layout: always written */
+  if (!rc && write_trailers(fout, pos, table, n, 1, dp, sums, NULL, 0, 0) == 0) { perror("write trailers"); rc = 2; }
+  if (!rc && fflush(fout) != 0) { perror("flush"); rc = 2; }
+
+  if (!rc && opt->verbose) {
+    fprintf(stderr, "compressed %llu -> %llu bytes in %u chunks, %u incompressible (stream, algo=%d, %u probes, %u switches)\n",
+            (unsigned long long)total, (unsigned long long)comp_total, n, n_screened,
+            prefer ? prefer : (bd.current ? bd.current : WARP_ALGO_ZSTD), bd.probes, bd.switches);
+  }
+
+  tp_destroy(tp);
+  job_sync_destroy(&sync);
+  free(jobs);
+  free(table);
+  free(sums);
+  pool_destroy(in_pool);
+  pool_destroy(out_pool);
+  warp_dict_free(dict);
+  return rc;
+}
 
-  bufpool_t *in_pool  = pool_create(chunk,   threads*2);
-  bufpool_t *out_pool = pool_create(out_cap, threads*2);
-  if (!in_pool || !out_pool) {
+#ifdef HAVE_XXHASH
+/* After the last payload of a sequential read: skip WIX, pick up the WCHK
+ * block. Returns its kind, with the whole-file digest in *want or the
+ * per-chunk sums in *sums (malloc'd, *nsums of them); 0 if there is none. */
+static int read_tail_chk(FILE *fin, unsigned long long *want, uint64_t **sums, uint32_t *nsums) {
+  uint32_t magic;
+  if (fread(&magic, 4, 1, fin) != 1) return 0;
+  if (magic == WIX_MAGIC) {
+    uint32_t cnt;
+    if (fread(&cnt, 4, 1, fin) != 1) return 0;
+    for (uint64_t k = 0; k < (uint64_t)cnt * sizeof(wix_entry_v1_t) + 4; k++)
+      if (fgetc(fin) == EOF) return 0;
+    if (fread(&magic, 4, 1, fin) != 1) return 0;
+  }
+  if (magic != WCHK_MAGIC) return 0;
+  unsigned char rest[sizeof(wchk_header_t) - 4];
+  if (fread(rest, sizeof(rest), 1, fin) != 1 || rest[1] != 8) return 0;
+  if (rest[0] == WARP_CHK_XXH64) return fread(want, 8, 1, fin) == 1 ? WARP_CHK_XXH64 : 0;
+  if (rest[0] != WARP_CHK_XXH3 || fread(nsums, sizeof(*nsums), 1, fin) != 1) return 0;
+  if (!(*sums = (uint64_t*)malloc(*nsums ? *nsums * sizeof(**sums) : 1))) return 0;
+  if (fread(*sums, sizeof(**sums), *nsums, fin) != *nsums) { free(*sums); *sums = NULL; return 0; }
+  return WARP_CHK_XXH3;
+}
+#endif
+
+/* WARP_ALGO_DUP entries take the algo of the chunk they repeat, which must
+ * be a self-contained chunk of the same size. -1 on a bad reference. */
+static int resolve_dups(warp_chunk_t *t, uint32_t n) {
+  for (uint32_t i = 0; i < n; i++) {
+    if (t[i].algo != WARP_ALGO_DUP) continue;
+    if (t[i].ref == 0 || t[i].ref > i) return -1;
+    const warp_chunk_t *d = &t[i - t[i].ref];
+    if (d->algo == WARP_ALGO_ZSTD_REF || d->orig_len != t[i].orig_len) return -1;
+    t[i].algo = d->algo;
+  }
+  return 0;
+}
+
+/*
+ * Sequential decode for pipes on either side: entries come from the table
+ * (default layout) or inline (stream layout), payloads are read in order,
+ * decoded on the pool and written in order within a threads*2 window.
+ */
+static int decompress_stream(FILE *fin, FILE *fout, const warp_header_t *hdr, const warp_opts_t *opt) {
+  const int threads   = opt->threads > 0 ? opt->threads : 1;
+  const int appended  = (hdr->flags & WARP_FLAG_APPEND) != 0;
+  const int inline_ents = (hdr->flags & WARP_FLAG_STREAM) && !appended;
+  const size_t depth  = (size_t)threads * WARP_WINDOW_PER_THREAD;
+  const size_t in_cap = chunk_out_cap(hdr->chunk_size);
+
+  warp_chunk_t *table = NULL;
+  uint32_t count = hdr->chunk_count;
+  if (!(hdr->flags & WARP_FLAG_STREAM)) {
+    table = (warp_chunk_t*)malloc(sizeof(*table) * (count ? count : 1));
+    if (!table) return 3;
+    if (fread(table, sizeof(*table), count, fin) != count || resolve_dups(table, count) != 0) {
+      fprintf(stderr, "bad table\n"); free(table); return 2;
+    }
+  }
+  warp_dict_t *dict = NULL;
+  if ((hdr->flags & WARP_FLAG_DICT) && !(dict = warp_dict_fread(fin, 0))) {
+    fprintf(stderr, "bad dictionary block\n"); free(table); return 2;
+  }
+  uint64_t *sums = NULL; /* appended: per-chunk sums known up front */
+  if (appended) { /* later segments are only reachable from the trailers */
+    free(table); table = NULL;
+    if (warp_read_table(fileno(fin), &table, &count, opt->verify ? &sums : NULL) != 0 || resolve_dups(table, count) != 0) {
+      fprintf(stderr, "appended container needs a seekable input\n"); free(table); free(sums); warp_dict_free(dict); return 2;
+    }
+  }
+
+  bufpool_t *in_pool  = pool_create(depth, in_cap);
+  bufpool_t *out_pool = pool_create(depth, hdr->chunk_size);
+  d_job_t   *jobs     = (d_job_t*)calloc(depth, sizeof(*jobs));
+  tp_t      *tp       = (in_pool && out_pool && jobs) ? tp_create((size_t)threads) : NULL;
+  if (!tp) {
+    fprintf(stderr, "pool OOM\n");
+    if (in_pool)  pool_destroy(in_pool);
+    if (out_pool) pool_destroy(out_pool);
+    free(jobs); free(table); free(sums); warp_dict_free(dict);
+    return 1;
+  }
+  job_sync_t sync;
+  job_sync_init(&sync);
+
+  /* otherwise the workers hash each chunk and the sums are compared once the
+   * trailer has been read */
+  uint64_t *have = NULL;
+  uint32_t have_cap = 0;
+  const int hash = opt->verify && !appended;
+#ifdef HAVE_XXHASH
+  XXH64_state_t *st = NULL;
+  if (opt->verify && !appended) { st = XXH64_createState(); XXH64_reset(st, 0); }
+#endif
+
+  /*
+   * REF chunks need the output of their group's first chunk: it is copied
+   * aside as it is written, and a REF chunk is held back until then. Only
+   * group heads are copied, so members that fell back to another codec
+   * cannot replace the prefix while the group's REF chunks still use it.
+   */
+  unsigned char *prefix = (hdr->flags & WARP_FLAG_PREFIX) ? (unsigned char*)malloc(hdr->chunk_size ? hdr->chunk_size : 1) : NULL;
+  uint8_t *head = (prefix && table) ? (uint8_t*)calloc(count ? count : 1, 1) : NULL;
+  uint32_t prefix_idx = UINT32_MAX;
+  size_t prefix_len = 0;
+  int held = 0;
+  for (uint32_t i = 0; head && i < count; i++)
+    if (table[i].algo == WARP_ALGO_ZSTD_REF && table[i].ref && table[i].ref <= i) head[i - table[i].ref] = 1;
+
+  uint32_t issued = 0, written = 0;
+  int eof = 0, rc = 0;
+  if ((hdr->flags & WARP_FLAG_PREFIX) && (!prefix || (table && !head))) { fprintf(stderr, "OOM\n"); rc = 3; }
+
+  while (!rc) {
+    while (!eof && issued - written < depth) {
+      d_job_t *j = &jobs[issued % depth];
+      if (held) {
+        const uint32_t a = issued - j->ent.ref;
+        if (written <= a) break;
+        held = 0;
+        if (prefix_idx != a) { fprintf(stderr, "bad chunk entry\n"); pool_release(in_pool, (void*)j->src); rc = 2; break; }
+        j->prefix = prefix; j->prefix_len = prefix_len;
+        if (tp_submit(tp, do_decompress_win, j) != 0) { pool_release(in_pool, (void*)j->src); rc = 3; break; }
+        issued++;
+        continue;
+      }
+      warp_chunk_t ent;
+      if (inline_ents) {
+        if (fread(&ent, sizeof(ent), 1, fin) != 1) { fprintf(stderr, "truncated stream\n"); rc = 2; break; }
+        if (ent.orig_len == 0) { eof = 1; break; }
+      } else {
+        if (issued == count) { eof = 1; break; }
+        ent = table[issued];
+      }
+      if (ent.orig_len > hdr->chunk_size || ent.comp_len > in_cap ||
+          (ent.algo == WARP_ALGO_ZSTD_REF && (!prefix || ent.ref == 0 || ent.ref > issued))) { fprintf(stderr, "bad chunk entry\n"); rc = 2; break; }
+
+      memset(j, 0, sizeof(*j));
+      j->fd = -1; j->idx = issued; j->ent = ent;
+      j->out_pool = out_pool; j->sync = &sync; j->dict = dict;
+      j->sums = sums ? &sums[issued] : NULL; j->hash = hash;
+      /* resolved DUP entries (ref set, not a prefix reference) repeat an
+       * earlier payload that is no longer next in the input; appended
+       * segments sit behind trailers */
+      const int seek = appended || (ent.ref && ent.algo != WARP_ALGO_ZSTD_REF);
+      if (ent.algo != WARP_ALGO_ZERO) {
+        unsigned char *src = (unsigned char*)pool_acquire_wait(in_pool, -1);
+        if (!src) { fprintf(stderr, "pool exhausted\n"); rc = 3; break; }
+        if (seek && wc_pread(fileno(fin), src, ent.comp_len, ent.offset) != (ssize_t)ent.comp_len) {
+          fprintf(stderr, appended ? "payload %u: read failed\n" : "deduplicated chunk %u needs a seekable input\n", issued); pool_release(in_pool, src); rc = 2; break;
+        }
+        if (!seek && fread(src, 1, ent.comp_len, fin) != ent.comp_len) {
+          fprintf(stderr, "truncated payload\n"); pool_release(in_pool, src); rc = 2; break;
+        }
+        j->src = src;
+      }
+      if (ent.algo == WARP_ALGO_ZSTD_REF) { held = 1; continue; }
+      if (tp_submit(tp, do_decompress_win, j) != 0) { pool_release(in_pool, (void*)j->src); rc = 3; break; }
+      issued++;
+    }
+    if (rc || written == issued) break;
+
+    d_job_t *j = &jobs[written % depth];
+    job_sync_wait(&sync, &j->done);
+    pool_release(in_pool, (void*)j->src);
+    if (!j->ok) {
+      fprintf(stderr, j->bad_sum ? "checksum mismatch in chunk %u\n" : "decompress chunk %u failed\n", written);
+      pool_release(out_pool, j->buf); written++; rc = 2; break;
+    }
+    if (hash && written >= have_cap) {
+      uint32_t ncap = have_cap ? have_cap * 2 : 256;
+      uint64_t *nh = (uint64_t*)realloc(have, ncap * sizeof(*nh));
+      if (!nh) { fprintf(stderr, "OOM\n"); pool_release(out_pool, j->buf); written++; rc = 3; break; }
+      have = nh; have_cap = ncap;
+    }
+    if (hash) have[written] = j->ent.algo == WARP_ALGO_ZERO ? 0 : j->sum;
+    if (fwrite(j->buf, 1, j->ent.orig_len, fout) != j->ent.orig_len) { perror("fwrite"); rc = 2; }
+#ifdef HAVE_XXHASH
+    if (st) XXH64_update(st, j->buf, j->ent.orig_len);
+#endif
+    if (head && head[written]) {
+      memcpy(prefix, j->buf, j->ent.orig_len);
+      prefix_idx = written; prefix_len = j->ent.orig_len;
+    }
+    pool_release(out_pool, j->buf);
+    written++;
+  }
+
+  for (; written < issued; written++) {
+    d_job_t *j = &jobs[written % depth];
+    job_sync_wait(&sync, &j->done);
+    pool_release(in_pool, (void*)j->src);
+    pool_release(out_pool, j->buf);
+  }
+  if (held) pool_release(in_pool, (void*)jobs[issued % depth].src);
+  if (!rc && fflush(fout) != 0) { perror("flush"); rc = 2; }
+
+#ifdef HAVE_XXHASH
+  if (st) {
+    unsigned long long digest = XXH64_digest(st), want = 0;
+    uint64_t *tail_sums = NULL;
+    uint32_t ntail = 0;
+    XXH64_freeState(st);
+    const int kind = rc ? 0 : read_tail_chk(fin, &want, &tail_sums, &ntail);
+    if (kind == WARP_CHK_XXH64 && want != digest) { fprintf(stderr, "checksum mismatch\n"); rc = 2; }
+    if (kind == WARP_CHK_XXH3 && ntail != written) { fprintf(stderr, "checksum mismatch\n"); rc = 2; }
+    for (uint32_t i = 0; kind == WARP_CHK_XXH3 && !rc && i < written; i++)
+      if (tail_sums[i] && tail_sums[i] != have[i]) { fprintf(stderr, "checksum mismatch in chunk %u\n", i); rc = 2; }
+    free(tail_sums);
+  }
+#endif
+
+  tp_destroy(tp);
+  job_sync_destroy(&sync);
+  free(jobs);
+  free(table);
+  free(sums);
+  free(have);
+  pool_destroy(in_pool);
+  pool_destroy(out_pool);
+  warp_dict_free(dict);
+  free(prefix);
+  free(head);
+  return rc;
+}
+
+/* ---------- public API ---------- */
+
+/* An open container that compress_input extends by one segment. */
+typedef struct {
+  FILE          *fout;     /* opened rb+, left open */
+  warp_header_t  hdr;      /* as read; only its flags are rewritten */
+  warp_dict_t   *dict;     /* the container's dictionary, owned by the caller */
+  uint64_t       start;    /* input bytes already stored */
+  uint64_t       end;      /* container size: the new segment starts here */
+  uint64_t       prev_ftr; /* footer of the previous segment */
+} c_append_t;
+
+/*
+ * Compresses a seekable input: the file fd_in, or with mem the archive
+ * members back to back (read per chunk by the workers, never mapped). man
+ * is written as an extra trailer when given. With app only the input past
+ * app->start is compressed, as a new segment at the end of app->fout.
+ */
+static int compress_input(int fd_in, const warp_member_t *mem, uint32_t nmem, size_t total,
+                          const void *man, size_t man_len, const char *out_path,
+                          const c_append_t *app, const warp_opts_t *opt) {
+  const int threads   = opt->threads > 0 ? opt->threads : 1;
+  const int level     = opt->level   > 0 ? opt->level   : 1;
+  const int prefer    = opt->algo; /* 0=auto */
+  const int do_idx    = opt->do_index || man || app; /* extraction and segment chains need random access */
+  const int do_chk    = app && opt->chk_kind == WARP_CHK_XXH64 ? 0 : opt->chk_kind; /* a whole-file digest cannot be extended */
+  const int auto_mode = opt->auto_mode;
+  const int warmup    = (opt->auto_lock > 0 ? opt->auto_lock : 4);
+  const uint64_t start = app ? app->start : 0;
+
+  uint32_t chunk = app ? app->hdr.chunk_size : opt->chunk_bytes ? (uint32_t)opt->chunk_bytes : warp_pick_chunk_size(total);
+
+  /* with a mapping the workers read the page cache and in_pool stays unused */
+  const unsigned char *map = (opt->no_mmap || mem) ? NULL : (const unsigned char*)file_map_rd(fd_in, total);
+
+  /* sparse inputs: holes become ZERO entries and are never read;
+   * content-defined chunking also finds duplicate chunks */
+  uint64_t *cut = NULL;
+  uint8_t *hole = NULL;
+  uint32_t *dup = NULL;
+  uint32_t n = 0, n_holes = 0, n_dups = 0;
+  const int prc = opt->cdc ? plan_cdc(fd_in, mem, nmem, map, start, total, chunk, &cut, &hole, &dup, &n)
+                           : plan_chunks(fd_in, start, total, chunk, &cut, &hole, &n);
+  if (prc != 0) {
+    if (prc == -2) perror("read in"); else fprintf(stderr, "OOM\n");
+    file_unmap(map, total); return prc == -2 ? 2 : 3;
+  }
+  for (uint32_t i = 0; i < n; i++) n_holes += hole[i];
+
+  FILE *fout = app ? app->fout : fopen(out_path, "wb+");
+  if (!fout) { perror("fopen out"); free(cut); free(hole); free(dup); file_unmap(map, total); return 1; }
+
+  size_t out_cap = chunk_out_cap(chunk);
+  const size_t depth = (size_t)threads * WARP_WINDOW_PER_THREAD;
+
+  /* prefix groups: chunks after the first of each group compress against it */
+  const uint32_t group = (opt->prefix_group > 1 && !opt->cdc && (prefer == 0 || prefer == WARP_ALGO_ZSTD)) ? (uint32_t)opt->prefix_group : 0;
+  bufpool_t *in_pool  = map ? NULL : pool_create(group ? 2 * depth : depth, chunk);
+  bufpool_t *out_pool = pool_create(depth, out_cap);
+  c_job_t   *jobs     = (c_job_t*)calloc(depth, sizeof(*jobs));
+  warp_chunk_t *table = (warp_chunk_t*)calloc(n ? n : 1, sizeof(*table));
+  tp_t      *tp       = ((in_pool || map) && out_pool && jobs && table) ? tp_create((size_t)threads) : NULL;
+  if (!tp) {
     fprintf(stderr, "pool OOM\n");
     if (in_pool)  pool_destroy(in_pool);
     if (out_pool) pool_destroy(out_pool);
-    fclose(fout); close(fd_in);
+    free(jobs); free(table); free(cut); free(hole); free(dup); file_unmap(map, total);
+    if (!app) fclose(fout);
     return 1;
   }
+  job_sync_t sync;
+  job_sync_init(&sync);
 
   warp_header_t hdr;
   memset(&hdr, 0, sizeof(hdr));
@@ -270,203 +1361,379 @@ int warp_compress_file(const char *in_path, const char *out_path, const warp_opt
   hdr.chunk_count = n;
   hdr.orig_size   = total;
   hdr.comp_size   = 0;
+  warp_dict_t *dict = NULL;
+  int rc = 0;
+  if (app) { hdr = app->hdr; hdr.comp_size = 0; dict = app->dict; }
+  else if (open_dict(opt, level, &dict) != 0) rc = 1;
+  if (dict) hdr.flags |= WARP_FLAG_DICT;
 
-  if (fwrite(&hdr, sizeof(hdr), 1, fout) != 1) { perror("write hdr"); fclose(fout); close(fd_in); pool_destroy(in_pool); pool_destroy(out_pool); return 2; }
-
-  warp_chunk_t *table = (warp_chunk_t*)calloc(n, sizeof(*table));
-  if (!table) { fclose(fout); close(fd_in); pool_destroy(in_pool); pool_destroy(out_pool); return 3; }
-
-  if (fwrite(table, sizeof(*table), n, fout) != n) { perror("write table"); free(table); fclose(fout); close(fd_in); pool_destroy(in_pool); pool_destroy(out_pool); return 2; }
-
-  /* warm-up */
-  int locked_algo = prefer;
-  int warm_n = (prefer == 0) ? (warmup < (int)n ? warmup : (int)n) : 0;
-
-  long payload_pos = ftell(fout);
+  uint64_t *sums = NULL; /* WARP_CHK_XXH3, hashed by the workers */
+#ifdef HAVE_XXHASH
+  /* digest of the original, fed in chunk order as chunks are written */
+  XXH64_state_t *st = NULL;
+  unsigned char *dup_buf = NULL;
+  if (do_chk == WARP_CHK_XXH64) { st = XXH64_createState(); XXH64_reset(st, 0); }
+  if (do_chk == WARP_CHK_XXH3 && !(sums = (uint64_t*)calloc(n ? n : 1, sizeof(*sums)))) { fprintf(stderr, "OOM\n"); rc = 3; }
+#endif
 
-  if (warm_n > 0) {
-    tp_t *tp = tp_create(threads);
-    c_job_t *jobs = (c_job_t*)calloc(warm_n, sizeof(*jobs));
-    for (int i = 0; i < warm_n; i++) {
-      size_t off = (size_t)i * chunk;
-      size_t len = (off + chunk <= total) ? chunk : (total - off);
-      jobs[i].fd = fd_in; jobs[i].offset = off; jobs[i].len = len;
-      jobs[i].prefer_algo = 0; jobs[i].level = level; jobs[i].idx = (uint32_t)i;
-      jobs[i].in_pool = in_pool; jobs[i].out_pool = out_pool; jobs[i].out_cap = out_cap;
-      tp_submit(tp, do_compress, &jobs[i]);
+  if (app) { if (fseek(fout, (long)app->end, SEEK_SET) != 0) { perror("seek out"); rc = 2; } }
+  else if (!rc && (fwrite(&hdr, sizeof(hdr), 1, fout) != 1 || fwrite(table, sizeof(*table), n, fout) != n ||
+                   (dict && warp_dict_fwrite(fout, dict) != 0))) { perror("write hdr"); rc = 2; }
+
+  /*
+   * Sliding window: at most `depth` chunks are in flight and finished ones
+   * are written in order while later ones still compress, so memory is
+   * O(threads * chunk) whatever the input size. In auto mode the first
+   * `warmup` chunks try every codec and the window drains once before the
+   * bandit takes over; with a calibration profile there is no warm-up.
+   */
+  warp_profile_t prof;
+  const int profiled = load_profile(opt, &prof);
+  const uint32_t warm_n = (prefer == 0 && !profiled) ? (warmup < (int)n ? (uint32_t)warmup : n) : 0;
+  int ready = warm_n == 0;
+  uint64_t pos = app ? app->end : sizeof(hdr) + (uint64_t)n * sizeof(*table) + warp_dict_block_size(dict);
+  uint32_t issued = 0, written = 0, n_screened = 0;
+  codec_bandit_t bd;
+  bandit_init(&bd, auto_mode);
+
+  while (!rc) {
+    while (issued < n && issued - written < depth && (ready || issued < warm_n)) {
+      c_job_t *j = &jobs[issued % depth];
+      size_t off = (size_t)cut[issued];
+      memset(j, 0, sizeof(*j));
+      j->fd = fd_in; j->mem = mem; j->nmem = nmem; j->offset = off; j->len = (size_t)(cut[issued + 1] - cut[issued]);
+      j->level = level; j->idx = issued;
+      j->in_pool = in_pool; j->out_pool = out_pool; j->out_cap = out_cap;
+      j->map = map; j->sync = &sync; j->want_sum = sums != NULL;
+      if (hole[issued]) { /* nothing to read or compress */
+        j->out_algo = WARP_ALGO_ZERO; j->ok = 1; j->done = 1;
+        issued++;
+        continue;
+      }
+      if (dup && dup[issued] != UINT32_MAX) { /* payload already stored */
+        j->out_algo = WARP_ALGO_DUP; j->ref = issued - dup[issued]; j->ok = 1; j->done = 1;
+        issued++;
+        continue;
+      }
+      j->prefer_algo = prefer || profiled ? prefer : (issued < warm_n ? 0 : bandit_choose(&bd));
+      j->auto_mode = auto_mode; j->sample_bytes = opt->sample_bytes;
+      j->profile = profiled ? &prof : NULL;
+      j->dict = dict;
+      const uint32_t a = group ? issued - issued % group : issued;
+      if (a != issued && !hole[a]) {
+        j->prefix_off = (size_t)cut[a]; j->prefix_len = (size_t)(cut[a + 1] - cut[a]);
+        j->ref = issued - a;
+      }
+      if (map) file_map_willneed(map, off, j->len);
+      if (tp_submit(tp, do_compress_win, j) != 0) { rc = 3; break; }
+      issued++;
     }
-    tp_barrier(tp);
-
-    double z_mbps=0,z_cnt=0, z_ratio=0;
-    double l_mbps=0,l_cnt=0, l_ratio=0;
-    double s_mbps=0,s_cnt=0, s_ratio=0;
-
-    for (int i = 0; i < warm_n; i++) {
-      if (!jobs[i].ok) { fprintf(stderr, "warm-up chunk %d failed\n", i);
-        free(jobs); free(table); fclose(fout); close(fd_in); pool_destroy(in_pool); pool_destroy(out_pool); return 2; }
-      double mbps  = (jobs[i].secs>0) ? (jobs[i].len/(1024.0*1024.0))/jobs[i].secs : 0.0;
-      double ratio = (double)jobs[i].comp_len / (double)jobs[i].len;
-      if (jobs[i].out_algo == WARP_ALGO_ZSTD)   { z_mbps += mbps; z_cnt++; z_ratio += ratio; }
-      if (jobs[i].out_algo == WARP_ALGO_LZ4)    { l_mbps += mbps; l_cnt++; l_ratio += ratio; }
-      if (jobs[i].out_algo == WARP_ALGO_SNAPPY) { s_mbps += mbps; s_cnt++; s_ratio += ratio; }
+    if (rc || written == issued) break;
+
+    c_job_t *j = &jobs[written % depth];
+    job_sync_wait(&sync, &j->done);
+    if (!j->ok) { fprintf(stderr, "compress chunk %u failed\n", written); rc = 2; break; }
+
+    warp_chunk_t *e = &table[written];
+    e->orig_len = (uint32_t)j->len;
+    e->comp_len = (uint32_t)j->comp_len;
+    e->offset   = pos;
+    e->algo     = (uint8_t)j->out_algo;
+    if (j->out_algo == WARP_ALGO_ZSTD_REF) { e->ref = j->ref; hdr.flags |= WARP_FLAG_PREFIX; }
+    if (j->out_algo == WARP_ALGO_DUP) {
+      const warp_chunk_t *d = &table[written - j->ref];
+      e->offset = d->offset; e->comp_len = d->comp_len; e->ref = j->ref;
+      n_dups++;
     }
-    if (z_cnt>0) { z_mbps/=z_cnt; z_ratio/=z_cnt; }
-    if (l_cnt>0) { l_mbps/=l_cnt; l_ratio/=l_cnt; }
-    if (s_cnt>0) { s_mbps/=s_cnt; s_ratio/=s_cnt; }
-
-    locked_algo = score_pick_algo(auto_mode, chunk,
-                                  (size_t)(z_ratio*chunk), z_mbps,
-                                  (size_t)(l_ratio*chunk), l_mbps,
-                                  (size_t)(s_ratio*chunk), s_mbps);
-
-    /* write warm chunks sequentially */
-    fseek(fout, payload_pos, SEEK_SET);
-    size_t written_here = 0;
-    for (int i = 0; i < warm_n; i++) {
-      long my_off = (long)payload_pos + (long)written_here;
-      table[i].orig_len = (uint32_t)jobs[i].len;
-      table[i].comp_len = (uint32_t)jobs[i].comp_len;
-      table[i].offset   = (uint64_t)my_off;
-      table[i].algo     = (uint8_t)jobs[i].out_algo;
-
-      if (jobs[i].out_algo != WARP_ALGO_ZERO) {
-        if (fwrite(jobs[i].comp, jobs[i].comp_len, 1, fout) != 1) { perror("fwrite"); }
-        written_here += jobs[i].comp_len;
-        pool_release(out_pool, jobs[i].comp);
-      }
-      pool_release(in_pool, jobs[i].in_buf);
+    if (sums) sums[written] = j->out_algo == WARP_ALGO_DUP ? sums[written - j->ref] : j->out_algo == WARP_ALGO_ZERO ? 0 : j->sum;
+    int wok = 1;
+    if (j->out_algo != WARP_ALGO_ZERO && j->out_algo != WARP_ALGO_DUP) {
+      wok = fwrite(j->comp, j->comp_len, 1, fout) == 1;
+      pos += j->comp_len;
+      hdr.comp_size += j->comp_len;
+      pool_release(out_pool, j->comp);
     }
-    hdr.comp_size += written_here;
-    payload_pos += (long)written_here;
-
-    free(jobs);
-    tp_destroy(tp);
-  }
-
-  /* rest with locked algo */
-  if (warm_n < (int)n) {
-    int rest = (int)n - warm_n;
-    tp_t *tp2 = tp_create(threads);
-    c_job_t *jobs2 = (c_job_t*)calloc(rest, sizeof(*jobs2));
-    for (int j = 0; j < rest; j++) {
-      uint32_t i = (uint32_t)(warm_n + j);
-      size_t off = (size_t)i * chunk;
-      size_t len = (off + chunk <= total) ? chunk : (total - off);
-      jobs2[j].fd = fd_in; jobs2[j].offset = off; jobs2[j].len = len;
-      jobs2[j].prefer_algo = (locked_algo ? locked_algo : WARP_ALGO_ZSTD);
-      jobs2[j].level = level; jobs2[j].idx = i;
-      jobs2[j].in_pool = in_pool; jobs2[j].out_pool = out_pool; jobs2[j].out_cap = out_cap;
-      tp_submit(tp2, do_compress, &jobs2[j]);
+#ifdef HAVE_XXHASH
+    if (st && hole[written]) xxh_update_zeros(st, j->len);
+    else if (st && !map && j->out_algo == WARP_ALGO_DUP) { /* nothing was read: fetch it for the digest */
+      if (!dup_buf) dup_buf = (unsigned char*)malloc(chunk);
+      if (dup_buf && src_pread(fd_in, mem, nmem, dup_buf, j->len, (uint64_t)j->offset) == (ssize_t)j->len) XXH64_update(st, dup_buf, j->len);
+      else wok = 0;
     }
-    tp_barrier(tp2);
+    else if (st) XXH64_update(st, map ? map + j->offset : j->in_buf, j->len);
+#endif
+    pool_release(in_pool, j->in_buf);
+    if (!wok) { perror("fwrite"); written++; rc = 2; break; }
 
-    fseek(fout, payload_pos, SEEK_SET);
-    size_t written_here = 0;
+    if (!prefer && !profiled) bandit_update(&bd, j);
+    n_screened += (uint32_t)j->screened;
+    written++;
+    if (!ready && written == warm_n) ready = 1;
+  }
 
-    for (int j = 0; j < rest; j++) {
-      uint32_t i = (uint32_t)(warm_n + j);
-      if (!jobs2[j].ok) {
-        fprintf(stderr, "compress chunk %u failed\n", i);
-        free(jobs2); free(table); fclose(fout); close(fd_in); pool_destroy(in_pool); pool_destroy(out_pool);
-        return 2;
-      }
-      long my_off = (long)payload_pos + (long)written_here;
-      table[i].orig_len = (uint32_t)jobs2[j].len;
-      table[i].comp_len = (uint32_t)jobs2[j].comp_len;
-      table[i].offset   = (uint64_t)my_off;
-      table[i].algo     = (uint8_t)jobs2[j].out_algo;
-
-      if (jobs2[j].out_algo != WARP_ALGO_ZERO) {
-        if (fwrite(jobs2[j].comp, jobs2[j].comp_len, 1, fout) != 1) { perror("fwrite"); }
-        written_here += jobs2[j].comp_len;
-        pool_release(out_pool, jobs2[j].comp);
-      }
-      pool_release(in_pool, jobs2[j].in_buf);
+  /* drain anything still in flight (error paths) */
+  for (; written < issued; written++) {
+    c_job_t *j = &jobs[written % depth];
+    job_sync_wait(&sync, &j->done);
+    if (j->ok && j->comp) pool_release(out_pool, j->comp);
+    pool_release(in_pool, j->in_buf);
+  }
+  tp_destroy(tp);
+  job_sync_destroy(&sync);
+  free(jobs);
+  free(cut);
+  free(hole);
+  free(dup);
+  pool_destroy(in_pool);
+  pool_destroy(out_pool);
+  if (!app) warp_dict_free(dict);
+
+  unsigned long long digest = 0, *dp = NULL;
+#ifdef HAVE_XXHASH
+  if (st) { digest = XXH64_digest(st); dp = &digest; XXH64_freeState(st); }
+  free(dup_buf);
+#else
+  (void)do_chk; (void)digest;
+#endif
+  if (rc) { free(table); free(sums); if (!app) fclose(fout); file_unmap(map, total); return rc; }
+
+  if (app) {
+    /* the new segment is complete before the header marks the chain */
+    warp_header_t h = app->hdr;
+    h.flags |= WARP_FLAG_APPEND | (hdr.flags & WARP_FLAG_PREFIX);
+    if (write_trailers(fout, pos, table, n, 1, NULL, sums, NULL, 0, app->prev_ftr) == 0 || fflush(fout) != 0 ||
+        fseek(fout, 0, SEEK_SET) != 0 || fwrite(&h, sizeof(h), 1, fout) != 1) { perror("write trailers"); rc = 2; }
+  } else {
+    /* patch table + header */
+    if (fseek(fout, sizeof(hdr), SEEK_SET) != 0 || fwrite(table, sizeof(*table), n, fout) != n ||
+        fseek(fout, 0, SEEK_SET) != 0 || fwrite(&hdr, sizeof(hdr), 1, fout) != 1 ||
+        fseek(fout, 0, SEEK_END) != 0) { perror("write table"); rc = 2; }
+
+    /* optional trailers: index + checksum + footer */
+    long end = rc ? -1 : ftell(fout);
+    if (!rc && (end < 0 || write_trailers(fout, (uint64_t)end, table, n, do_idx, dp, sums, man, man_len, 0) == 0)) {
+      perror("write trailers"); rc = 2;
     }
-    hdr.comp_size += written_here;
-    payload_pos += (long)written_here;
+  }
 
-    free(jobs2);
-    tp_destroy(tp2);
+  if (opt->verbose) {
+    fprintf(stderr, "compressed %zu -> %llu bytes in %u chunks, %u holes, %u duplicates, %u incompressible (algo=%d, %u probes, %u switches)\n",
+            (size_t)(total - start), (unsigned long long)hdr.comp_size, n, n_holes, n_dups, n_screened,
+            prefer ? prefer : (bd.current ? bd.current : WARP_ALGO_ZSTD), bd.probes, bd.switches);
   }
 
-  /* patch table + header */
-  fseek(fout, sizeof(hdr), SEEK_SET);
-  fwrite(table, sizeof(*table), n, fout);
-  fseek(fout, 0, SEEK_SET);
-  fwrite(&hdr, sizeof(hdr), 1, fout);
-  fseek(fout, 0, SEEK_END);
+  free(table);
+  free(sums);
+  if (!app && fclose(fout) != 0 && !rc) { perror("close output"); rc = 2; }
+  file_unmap(map, total);
+  return rc;
+}
 
-  /* optional trailers: index + checksum + footer */
-  uint64_t wix_off = 0, chk_off = 0;
+/* Refuses checksums this build cannot write; CDC without xxHash still
+ * cuts at content boundaries but cannot fingerprint chunks. */
+static int check_build_opts(const warp_opts_t *opt) {
+#ifndef HAVE_XXHASH
+  if (opt->chk_kind != WARP_CHK_NONE) { fprintf(stderr, "checksums need xxHash, which this build lacks\n"); return 1; }
+  if (opt->cdc) fprintf(stderr, "warning: built without xxHash, --cdc cannot dedup chunks\n");
+#else
+  (void)opt;
+#endif
+  return 0;
+}
 
-  if (do_idx) {
-    wix_off = (uint64_t)ftell(fout);
-    wix_header_t wh = { WIX_MAGIC, n };
-    fwrite(&wh, sizeof(wh), 1, fout);
-    for (uint32_t i = 0; i < n; i++) {
-      wix_entry_v1_t e;
-      e.payload_off = table[i].offset;
-      e.orig_len    = table[i].orig_len;
-      e.comp_len    = table[i].comp_len;
-      e.algo        = table[i].algo;
-      memset(e._pad, 0, sizeof(e._pad));
-      fwrite(&e, sizeof(e), 1, fout);
-    }
-    uint32_t crc0 = 0;
-    fwrite(&crc0, 4, 1, fout);
+int warp_compress_file(const char *in_path, const char *out_path, const warp_opts_t *opt) {
+  if (check_build_opts(opt) != 0) return 1;
+  if (is_stdio(in_path) || is_stdio(out_path)) {
+    int fd_s = is_stdio(in_path) ? STDIN_FILENO : open(in_path, O_RDONLY);
+    if (fd_s < 0) { perror("open in"); return 1; }
+    FILE *fs = is_stdio(out_path) ? stdout : fopen(out_path, "wb");
+    if (!fs) { perror("fopen out"); if (fd_s != STDIN_FILENO) close(fd_s); return 1; }
+    int rc = compress_stream(fd_s, fs, opt);
+    if (fs != stdout) fclose(fs);
+    if (fd_s != STDIN_FILENO) close(fd_s);
+    return rc;
   }
 
-#ifdef HAVE_XXHASH
-  if (do_chk == WARP_CHK_XXH64) {
-    chk_off = (uint64_t)ftell(fout);
-    wchk_header_t ch = { WCHK_MAGIC, WARP_CHK_XXH64, 8, {0,0} };
-    fwrite(&ch, sizeof(ch), 1, fout);
+  size_t total = fsize(in_path);
+  if (!total) { fprintf(stderr, "input not found or empty\n"); return 1; }
 
-    /* stream original and compute xxh64 */
-    XXH64_state_t* st = XXH64_createState();
-    XXH64_reset(st, 0);
-    int fd2 = open(in_path, O_RDONLY);
-    if (fd2 >= 0) {
-      const size_t buf_sz = 1u << 20;
-      unsigned char *buf = (unsigned char*)malloc(buf_sz);
-      if (buf) {
-        for (;;) {
-          ssize_t r2 = read(fd2, buf, (unsigned)buf_sz);
-          if (r2 < 0) { perror("read chk"); break; }
-          if (r2 == 0) break;
-          XXH64_update(st, buf, (size_t)r2);
-        }
-        free(buf);
-      }
-      close(fd2);
-    }
-    unsigned long long d = XXH64_digest(st);
-    XXH64_freeState(st);
-    fwrite(&d, 8, 1, fout);
+  int fd_in = open(in_path, O_RDONLY);
+  if (fd_in < 0) { perror("open in"); return 1; }
+  wc_advise_sequential(fd_in);
+  int rc = compress_input(fd_in, NULL, 0, total, NULL, 0, out_path, NULL, opt);
+  close(fd_in);
+  return rc;
+}
+
+int warp_compress_members(const warp_member_t *mem, uint32_t nmem, uint64_t total,
+                          const void *man, size_t man_len,
+                          const char *out_path, const warp_opts_t *opt) {
+  if (check_build_opts(opt) != 0) return 1;
+  return compress_input(-1, mem, nmem, (size_t)total, man, man_len, out_path, NULL, opt);
+}
+
+int warp_append_file(const char *in_path, const char *warp_path, const warp_opts_t *opt) {
+  const int level = opt->level > 0 ? opt->level : 1;
+  FILE *fout = fopen(warp_path, "rb+");
+  if (!fout && errno == ENOENT) { /* first append: the whole input becomes the first segment */
+    if (opt->verbose) fprintf(stderr, "creating %s\n", warp_path);
+    return warp_compress_file(in_path, warp_path, opt);
+  }
+  if (!fout) { perror("open container"); return 1; }
+  if (check_build_opts(opt) != 0) { fclose(fout); return 1; }
+  const int fd = fileno(fout);
+  const off_t end = lseek(fd, 0, SEEK_END);
+
+  c_append_t app;
+  memset(&app, 0, sizeof(app));
+  app.fout = fout;
+  warp_chunk_t *table = NULL;
+  uint32_t n = 0;
+  if (pread_all(fd, &app.hdr, sizeof(app.hdr), 0) != 0 || app.hdr.magic != WARP_MAGIC || app.hdr.version != WARP_VER ||
+      warp_read_table(fd, &table, &n, NULL) != 0) { fprintf(stderr, "bad container\n"); free(table); fclose(fout); return 2; }
+  for (uint32_t i = 0; i < n; i++) app.start += table[i].orig_len;
+  free(table);
+
+  wftr_footer_t ft;
+  wftr_ext_t ext;
+  memset(&ext, 0, sizeof(ext));
+  const int has_ftr = end >= (off_t)(sizeof(app.hdr) + sizeof(ft)) && pread_all(fd, &ft, sizeof(ft), end - (off_t)sizeof(ft)) == 0 && ft.magic == WFTR_MAGIC;
+  if (has_ftr && (ft.flags & WFTR_FLAG_EXT) && pread_all(fd, &ext, sizeof(ext), end - (off_t)(sizeof(ft) + sizeof(ext))) != 0) { fprintf(stderr, "bad footer\n"); fclose(fout); return 2; }
+  if (ext.man_off) { fprintf(stderr, "cannot append to an archive\n"); fclose(fout); return 1; }
+
+  const uint64_t total = fsize(in_path);
+  if (total < app.start) { fprintf(stderr, "input is shorter than the stored data\n"); fclose(fout); return 1; }
+  if (total == app.start) {
+    if (opt->verbose) fprintf(stderr, "nothing to append\n");
+    fclose(fout); return 0;
+  }
+
+  /* codec options may change between appends; chunk size and dictionary may not */
+  const uint64_t dict_off = sizeof(app.hdr) + ((app.hdr.flags & WARP_FLAG_STREAM) ? 0 : (uint64_t)app.hdr.chunk_count * sizeof(warp_chunk_t));
+  if ((app.hdr.flags & WARP_FLAG_DICT) && !(app.dict = warp_dict_pread(fd, dict_off, level))) {
+    fprintf(stderr, "bad dictionary block\n"); fclose(fout); return 2;
+  }
+  if (opt->dict && *opt->dict) { /* only a check: the container's own dictionary is used */
+    warp_dict_t *d = warp_dict_load(opt->dict, 0);
+    const int same = d && app.dict && warp_dict_id(d) == warp_dict_id(app.dict) && warp_dict_block_size(d) == warp_dict_block_size(app.dict);
+    warp_dict_free(d);
+    if (!same) { fprintf(stderr, "%s is not the container's dictionary\n", opt->dict); warp_dict_free(app.dict); fclose(fout); return 1; }
   }
-#else
-  (void)do_chk;
-#endif
 
-  wftr_footer_t ft = { WFTR_MAGIC, wix_off, chk_off };
-  fwrite(&ft, sizeof(ft), 1, fout);
+  int rc = 0;
+  app.end = (uint64_t)end;
+  if (has_ftr) app.prev_ftr = app.end - sizeof(ft);
+  else { /* no trailers yet: give the header table a bare footer to chain to */
+    if (fseek(fout, (long)end, SEEK_SET) != 0 || write_trailers(fout, app.end, NULL, 0, 0, NULL, NULL, NULL, 0, 0) == 0) { perror("write footer"); rc = 2; }
+    app.prev_ftr = app.end;
+    app.end += sizeof(ft);
+  }
 
-  if (opt->verbose) {
-    fprintf(stderr, "compressed %zu -> %llu bytes in %u chunks (locked algo=%d)\n",
-            total, (unsigned long long)hdr.comp_size, n,
-            locked_algo ? locked_algo : WARP_ALGO_ZSTD);
+  int fd_in = -1;
+  if (!rc && (fd_in = open(in_path, O_RDONLY)) < 0) { perror("open in"); rc = 1; }
+  if (!rc) {
+    wc_advise_sequential(fd_in);
+    rc = compress_input(fd_in, NULL, 0, (size_t)total, NULL, 0, NULL, &app, opt);
+    close(fd_in);
+  }
+  if (rc) { /* a failed append leaves the container as it was */
+    fflush(fout);
+    if (ftruncate(fd, end) != 0) perror("truncate");
+  }
+  warp_dict_free(app.dict);
+  if (fclose(fout) != 0 && !rc) { perror("close"); rc = 2; }
+  return rc;
+}
+
+int warp_compact(const char *warp_path, const warp_opts_t *opt) {
+  int fd = open(warp_path, O_RDONLY);
+  if (fd < 0) { perror("open container"); return 1; }
+  warp_header_t hdr;
+  warp_chunk_t *table = NULL;
+  uint64_t *sums = NULL; /* carried over as they are */
+  uint32_t n = 0;
+  if (pread_all(fd, &hdr, sizeof(hdr), 0) != 0 || hdr.magic != WARP_MAGIC || hdr.version != WARP_VER ||
+      warp_read_table(fd, &table, &n, &sums) != 0) { fprintf(stderr, "bad container\n"); free(table); close(fd); return 2; }
+  if (!(hdr.flags & WARP_FLAG_APPEND)) {
+    if (opt->verbose) fprintf(stderr, "nothing to compact\n");
+    free(table); free(sums); close(fd); return 0;
+  }
+
+  const uint64_t dict_off = sizeof(hdr) + ((hdr.flags & WARP_FLAG_STREAM) ? 0 : (uint64_t)hdr.chunk_count * sizeof(warp_chunk_t));
+  warp_dict_t *dict = NULL;
+  if ((hdr.flags & WARP_FLAG_DICT) && !(dict = warp_dict_pread(fd, dict_off, 0))) {
+    fprintf(stderr, "bad dictionary block\n"); free(table); free(sums); close(fd); return 2;
+  }
+
+  uint32_t max_comp = 1;
+  hdr.flags      &= (uint16_t)~(WARP_FLAG_STREAM | WARP_FLAG_APPEND);
+  hdr.chunk_count = n;
+  hdr.orig_size   = 0;
+  hdr.comp_size   = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    hdr.orig_size += table[i].orig_len;
+    if (table[i].comp_len > max_comp) max_comp = table[i].comp_len;
+  }
+
+  char tmp[4096];
+  FILE *fout = NULL;
+  unsigned char *buf = (unsigned char*)malloc(max_comp);
+  int rc = 0;
+  if (snprintf(tmp, sizeof(tmp), "%s.tmp", warp_path) >= (int)sizeof(tmp) || !buf) rc = 3;
+  else if (!(fout = fopen(tmp, "wb"))) { perror("fopen out"); rc = 1; }
+  else if (fwrite(&hdr, sizeof(hdr), 1, fout) != 1 || fwrite(table, sizeof(*table), n, fout) != n ||
+           (dict && warp_dict_fwrite(fout, dict) != 0)) { perror("write hdr"); rc = 2; }
+
+  /* payloads in table order; duplicates follow their original to its new place */
+  uint64_t pos = sizeof(hdr) + (uint64_t)n * sizeof(*table) + warp_dict_block_size(dict);
+  for (uint32_t i = 0; i < n && !rc; i++) {
+    warp_chunk_t *e = &table[i];
+    if (e->algo == WARP_ALGO_ZERO) { e->offset = 0; continue; }
+    if (e->algo == WARP_ALGO_DUP) {
+      if (e->ref == 0 || e->ref > i) { fprintf(stderr, "bad chunk entry %u\n", i); rc = 2; break; }
+      e->offset = table[i - e->ref].offset;
+      continue;
+    }
+    if (pread_all(fd, buf, e->comp_len, (off_t)e->offset) != 0) { perror("read payload"); rc = 2; break; }
+    if (fwrite(buf, e->comp_len, 1, fout) != 1) { perror("fwrite"); rc = 2; break; }
+    e->offset = pos;
+    pos += e->comp_len;
+    hdr.comp_size += e->comp_len;
   }
 
+  if (!rc && (fseek(fout, 0, SEEK_SET) != 0 || fwrite(&hdr, sizeof(hdr), 1, fout) != 1 ||
+              fwrite(table, sizeof(*table), n, fout) != n || fseek(fout, 0, SEEK_END) != 0 ||
+              write_trailers(fout, pos, table, n, 1, NULL, sums, NULL, 0, 0) == 0)) { perror("write trailers"); rc = 2; }
+  if (fout && fclose(fout) != 0 && !rc) { perror("close"); rc = 2; }
+  if (!rc && rename(tmp, warp_path) != 0) { perror("rename"); rc = 2; }
+  if (rc && fout) remove(tmp);
+  if (!rc && opt->verbose)
+    fprintf(stderr, "compacted %u chunks, %llu payload bytes\n", n, (unsigned long long)hdr.comp_size);
+
+  free(buf);
   free(table);
-  pool_destroy(in_pool);
-  pool_destroy(out_pool);
-  fclose(fout);
-  close(fd_in);
-  return 0;
+  free(sums);
+  warp_dict_free(dict);
+  close(fd);
+  return rc;
 }
 
 int warp_decompress_file(const char *in_path, const char *out_path, const warp_opts_t *opt) {
+  if (is_stdio(in_path) || is_stdio(out_path)) {
+    FILE *fs_in = is_stdio(in_path) ? stdin : fopen(in_path, "rb");
+    if (!fs_in) { perror("open in"); return 1; }
+    warp_header_t sh;
+    if (fread(&sh, sizeof(sh), 1, fs_in) != 1 || sh.magic != WARP_MAGIC || sh.version != WARP_VER) {
+      fprintf(stderr, "bad header\n"); if (fs_in != stdin) fclose(fs_in); return 2;
+    }
+    FILE *fs_out = is_stdio(out_path) ? stdout : fopen(out_path, "wb");
+    if (!fs_out) { perror("fopen out"); if (fs_in != stdin) fclose(fs_in); return 1; }
+    int rc = decompress_stream(fs_in, fs_out, &sh, opt);
+    if (fs_out != stdout) fclose(fs_out);
+    if (fs_in != stdin) fclose(fs_in);
+    return rc;
+  }
+
   int fd_in = open(in_path, O_RDONLY);
   if (fd_in < 0) { perror("open in"); return 1; }
   FILE *fin = fdopen(fd_in, "rb");
@@ -476,68 +1743,153 @@ int warp_decompress_file(const char *in_path, const char *out_path, const warp_o
   if (fread(&hdr, sizeof(hdr), 1, fin) != 1) { fprintf(stderr, "bad header\n"); fclose(fin); return 2; }
   if (hdr.magic != WARP_MAGIC || hdr.version != WARP_VER) { fprintf(stderr, "bad magic/version\n"); fclose(fin); return 2; }
 
-  warp_chunk_t *table = (warp_chunk_t*)malloc(sizeof(*table) * hdr.chunk_count);
-  if (!table) { fclose(fin); return 3; }
-  if (fread(table, sizeof(*table), hdr.chunk_count, fin) != hdr.chunk_count) {
-    fprintf(stderr, "bad table\n"); free(table); fclose(fin); return 2;
+  /* the dictionary sits between the header/table and the first payload */
+  const uint64_t dict_off = sizeof(hdr) + ((hdr.flags & WARP_FLAG_STREAM) ? 0 : (uint64_t)hdr.chunk_count * sizeof(warp_chunk_t));
+  warp_dict_t *dict = NULL;
+  if ((hdr.flags & WARP_FLAG_DICT) && !(dict = warp_dict_pread(fd_in, dict_off, 0))) {
+    fprintf(stderr, "bad dictionary block\n"); fclose(fin); return 2;
   }
 
+  /* header table or WIX trailers (streamed layout, appended segments); the
+   * workers check each chunk against its sum when verifying */
+  warp_chunk_t *table = NULL;
+  uint64_t *sums = NULL;
+  if (warp_read_table(fd_in, &table, &hdr.chunk_count, opt->verify ? &sums : NULL) != 0 || resolve_dups(table, hdr.chunk_count) != 0) {
+    fprintf(stderr, "bad table\n"); free(table); warp_dict_free(dict); fclose(fin); return 2;
+  }
+#ifndef HAVE_XXHASH
+  if (sums) fprintf(stderr, "warning: built without xxHash, chunk checksums are not verified\n");
+#endif
+  hdr.orig_size = 0;
+  for (uint32_t i = 0; i < hdr.chunk_count; i++) hdr.orig_size += table[i].orig_len;
+
   FILE *fout = fopen(out_path, "wb+");
-  if (!fout) { perror("fopen out"); free(table); fclose(fin); return 1; }
-  (void)wc_ftruncate_file(fout, hdr.orig_size); /* best-effort */
+  if (!fout) { perror("fopen out"); free(table); free(sums); warp_dict_free(dict); fclose(fin); return 1; }
+  /* pre-sizing a fresh file makes every ZERO chunk a hole; otherwise they are written */
+  const int sparse = wc_ftruncate_file(fout, hdr.orig_size) == 0;
+
+  const int threads = opt->threads > 0 ? opt->threads : 1;
+  const size_t depth = (size_t)threads * WARP_WINDOW_PER_THREAD;
+  /* a prefix group holds its first chunk's output while decoding the rest */
+  bufpool_t *out_pool = pool_create((hdr.flags & WARP_FLAG_PREFIX) ? 2 * depth : depth, hdr.chunk_size);
+  d_job_t *jobs = (d_job_t*)calloc(depth, sizeof(*jobs));
+  uint32_t *free_slots = (uint32_t*)calloc(depth, sizeof(*free_slots));
+  unsigned char *zeros = sparse ? NULL : (unsigned char*)calloc(1, hdr.chunk_size ? hdr.chunk_size : 1);
+  tp_t *tp = (out_pool && jobs && free_slots && (sparse || zeros)) ? tp_create((size_t)threads) : NULL;
+  if (!tp) {
+    fprintf(stderr, "pool OOM\n");
+    if (out_pool) pool_destroy(out_pool);
+    free(jobs); free(free_slots); free(zeros); free(table); free(sums); warp_dict_free(dict); fclose(fout); fclose(fin);
+    return 1;
+  }
 
-  bufpool_t *out_pool = pool_create(hdr.chunk_size, opt->threads>0 ? opt->threads*2 : 2);
-  if (!out_pool) { fprintf(stderr, "pool OOM\n"); free(table); fclose(fout); fclose(fin); return 1; }
+  /* payloads are decoded straight out of the mapping when available */
+  const size_t in_size = fsize(in_path);
+  const unsigned char *map = opt->no_mmap ? NULL : (const unsigned char*)file_map_rd(fd_in, in_size);
+
+  /*
+   * Every chunk's destination is known from the table, so workers write it
+   * themselves the moment it is decoded and hand the buffer straight back;
+   * the main thread only keeps at most `depth` chunks in flight.
+   */
+  d_window_t win;
+  memset(&win, 0, sizeof(win));
+  job_sync_init(&win.sync);
+  win.free = free_slots;
+  for (size_t k = 0; k < depth; k++) win.free[win.nfree++] = (uint32_t)(depth - 1 - k);
+
+  /* the longest reference bounds how far past its first chunk a group reaches */
+  uint32_t max_ref = 0;
+  for (uint32_t i = 0; i < hdr.chunk_count; i++)
+    if (table[i].algo == WARP_ALGO_ZSTD_REF && table[i].ref > max_ref) max_ref = table[i].ref;
 
-  tp_t *tp = tp_create(opt->threads > 0 ? opt->threads : 1);
-  d_job_t *jobs = (d_job_t*)calloc(hdr.chunk_count, sizeof(*jobs));
+  const int out_fd = fileno(fout);
+  int rc = 0;
+  uint64_t off = 0;
   for (uint32_t i = 0; i < hdr.chunk_count; i++) {
-    jobs[i].fd  = fd_in;
-    jobs[i].idx = i;
-    jobs[i].ent = table[i];
-    jobs[i].out_pool = out_pool;
-    tp_submit(tp, do_decompress, &jobs[i]);
+    const warp_chunk_t *e = &table[i];
+    if (e->orig_len > hdr.chunk_size ||
+        (e->algo == WARP_ALGO_ZSTD_REF && (e->ref == 0 || e->ref > i || table[i - e->ref].algo == WARP_ALGO_ZSTD_REF))) {
+      fprintf(stderr, "bad chunk entry %u\n", i); rc = 2; break;
+    }
+    /* REF chunks are decoded by the job of their group's first chunk */
+    if (e->algo == WARP_ALGO_ZSTD_REF) { off += e->orig_len; continue; }
+    uint32_t ndeps = 0;
+    for (uint32_t k = 1; k <= max_ref && i + k < hdr.chunk_count; k++)
+      if (table[i + k].algo == WARP_ALGO_ZSTD_REF && table[i + k].ref == k) ndeps = k;
+    pthread_mutex_lock(&win.sync.mtx);
+    while (win.nfree == 0 && !win.failed) pthread_cond_wait(&win.sync.cv, &win.sync.mtx);
+    uint32_t slot = win.failed ? 0 : win.free[--win.nfree];
+    int failed = win.failed;
+    pthread_mutex_unlock(&win.sync.mtx);
+    if (failed) break;
+
+    d_job_t *j = &jobs[slot];
+    memset(j, 0, sizeof(*j));
+    j->fd  = fd_in;
+    j->idx = i;
+    j->ent = table[i];
+    j->out_pool = out_pool;
+    j->win = &win; j->slot = slot;
+    j->out_fd = out_fd; j->out_off = off; j->zeros = zeros; j->dict = dict;
+    j->sums = sums ? &sums[i] : NULL;
+    if (map && table[i].algo != WARP_ALGO_ZERO && table[i].offset + table[i].comp_len <= in_size) {
+      j->src = map + table[i].offset;
+      file_map_willneed(map, table[i].offset, table[i].comp_len);
+    }
+    off += table[i].orig_len;
+    if (ndeps) {
+      j->deps = &table[i + 1]; j->ndeps = ndeps;
+      j->map = map; j->map_size = in_size;
+    }
+    if (tp_submit(tp, do_decompress_direct, j) != 0) { rc = 3; break; }
   }
-  tp_barrier(tp);
+
+  /* drain */
+  pthread_mutex_lock(&win.sync.mtx);
+  while (win.nfree < depth) pthread_cond_wait(&win.sync.cv, &win.sync.mtx);
+  pthread_mutex_unlock(&win.sync.mtx);
+  if (!rc && win.failed) {
+    fprintf(stderr, win.bad_sum ? "checksum mismatch in chunk %u\n" : "decompress chunk %u failed\n", win.bad_idx); rc = 2;
+  }
+
+  tp_destroy(tp);
+  job_sync_destroy(&win.sync);
+  free(free_slots);
+  free(zeros);
+  warp_dict_free(dict);
+  free(sums);
+  if (rc) { free(jobs); pool_destroy(out_pool); free(table); file_unmap(map, in_size); fclose(fout); fclose(fin); return rc; }
 
 #ifdef HAVE_XXHASH
-  XXH64_state_t* st = NULL;
+  /* a whole-file digest (older files): chunks land out of order, so it is
+   * taken over the finished output */
   wftr_footer_t ft;
+  wchk_header_t ch;
   long endpos;
   fseek(fin, 0, SEEK_END); endpos = ftell(fin);
   fseek(fin, endpos - (long)sizeof(ft), SEEK_SET);
   if (fread(&ft, sizeof(ft), 1, fin) != 1 || ft.magic != WFTR_MAGIC) { ft.chk_off = 0; }
-  if (opt->verify && ft.chk_off) { st = XXH64_createState(); XXH64_reset(st, 0); }
-#endif
-
-  /* ordered writes (pwrite) */
-  uint64_t off = 0;
-  const int out_fd = fileno(fout);
-  for (uint32_t i = 0; i < hdr.chunk_count; i++) {
-    if (!jobs[i].ok) {
-      fprintf(stderr, "decompress chunk %u failed\n", i);
-      free(jobs); pool_destroy(out_pool); free(table); fclose(fout); fclose(fin); return 2;
+  if (ft.chk_off && (fseek(fin, (long)ft.chk_off, SEEK_SET) != 0 || fread(&ch, sizeof(ch), 1, fin) != 1 || ch.kind != WARP_CHK_XXH64)) ft.chk_off = 0;
+  if (opt->verify && ft.chk_off) {
+    XXH64_state_t* st = XXH64_createState();
+    XXH64_reset(st, 0);
+    const size_t buf_sz = 1u << 20;
+    unsigned char *buf = (unsigned char*)malloc(buf_sz);
+    for (uint64_t pos = 0; buf && pos < off; ) {
+      size_t want = (off - pos > buf_sz) ? buf_sz : (size_t)(off - pos);
+      ssize_t r = wc_pread(out_fd, buf, want, pos);
+      if (r <= 0) { perror("read back"); rc = 2; break; }
+      XXH64_update(st, buf, (size_t)r);
+      pos += (uint64_t)r;
     }
-    wc_pwrite(out_fd, jobs[i].buf, table[i].orig_len, off);
-#ifdef HAVE_XXHASH
-    if (st) XXH64_update(st, jobs[i].buf, table[i].orig_len);
-#endif
-    off += table[i].orig_len;
-    pool_release(out_pool, jobs[i].buf);
-  }
-
-#ifdef HAVE_XXHASH
-  if (st) {
+    free(buf);
     unsigned long long have = XXH64_digest(st);
     XXH64_freeState(st);
-    wftr_footer_t ft2;
-    fseek(fin, endpos - (long)sizeof(ft2), SEEK_SET);
-    fread(&ft2, sizeof(ft2), 1, fin);
-    fseek(fin, (long)ft2.chk_off, SEEK_SET);
-    wchk_header_t ch; fread(&ch, sizeof(ch), 1, fin);
+    fseek(fin, (long)(ft.chk_off + sizeof(ch)), SEEK_SET);
     unsigned long long want = 0; fread(&want, 8, 1, fin);
-    if (!(ch.magic==WCHK_MAGIC && ch.kind==WARP_CHK_XXH64 && ch.dlen==8 && want==have)) {
-      fprintf(stderr, "checksum mismatch\n");
+    if (!rc && !(ch.magic==WCHK_MAGIC && ch.kind==WARP_CHK_XXH64 && ch.dlen==8 && want==have)) {
+      fprintf(stderr, "checksum mismatch\n"); rc = 2;
     }
   }
 #endif
@@ -545,12 +1897,21 @@ int warp_decompress_file(const char *in_path, const char *out_path, const warp_o
   free(jobs);
   pool_destroy(out_pool);
   free(table);
+  file_unmap(map, in_size);
   fclose(fout);
   fclose(fin);
-  return 0;
+  return rc;
 }
 
-
-
-
-
+int warp_calibrate(const char *path, int verbose) {
+  char def[4096];
+  warp_profile_t p;
+  if (!path) {
+    if (profile_default_path(def, sizeof(def)) != 0) { fprintf(stderr, "no profile location (set WARPC_PROFILE or HOME)\n"); return 1; }
+    path = def;
+  }
+  if (profile_calibrate(&p, run_algo, chunk_out_cap, verbose) != 0) { fprintf(stderr, "calibration failed\n"); return 2; }
+  if (profile_save(path, &p) != 0) { perror(path); return 2; }
+  if (verbose) fprintf(stderr, "wrote %d entries to %s\n", p.n, path);
+  return 0;
+}
@@ -0,0 +1,329 @@
+// src/dict.c
+#define _XOPEN_SOURCE 700
+#include "dict.h"
+#include "warp.h"
+#include "util.h"
+
+#ifdef HAVE_ZSTD
+#  include <zstd.h>
+#  include <zdict.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+struct warp_dict {
+  void     *buf;
+  size_t    len;
+  uint32_t  id;
+#ifdef HAVE_ZSTD
+  ZSTD_CDict *cdict; /* NULL when opened for decoding only */
+  ZSTD_DDict *ddict;
+#endif
+};
+
+#define WARP_DICT_DEFAULT  (112u * 1024u)
+#define WARP_TRAIN_SAMPLE  (64u * 1024u)
+#define WARP_DICT_MAX      (16u << 20)   /* sanity cap when reading a WDCT block */
+
+warp_dict_t *warp_dict_create(const void *buf, size_t n, int level) {
+#ifdef HAVE_ZSTD
+  warp_dict_t *d = (warp_dict_t*)calloc(1, sizeof(*d));
+  if (!d || !n || !(d->buf = malloc(n))) { free(d); return NULL; }
+  memcpy(d->buf, buf, n);
+  d->len = n;
+  d->id = (uint32_t)ZDICT_getDictID(buf, n);
+  d->ddict = ZSTD_createDDict(d->buf, n);
+  if (level > 0) d->cdict = ZSTD_createCDict(d->buf, n, level);
+  if (!d->ddict || (level > 0 && !d->cdict)) { warp_dict_free(d); return NULL; }
+  return d;
+#else
+  (void)buf; (void)n; (void)level;
+  return NULL;
+#endif
+}
+
+warp_dict_t *warp_dict_load(const char *path, int level) {
+  uint64_t n = 0;
+  if (file_stat_size(path, &n) != 0 || n == 0 || n > WARP_DICT_MAX) return NULL;
+  FILE *f = fopen(path, "rb");
+  void *buf = f ? malloc((size_t)n) : NULL;
+  warp_dict_t *d = NULL;
+  if (buf && fread(buf, 1, (size_t)n, f) == (size_t)n) d = warp_dict_create(buf, (size_t)n, level);
+  free(buf);
+  if (f) fclose(f);
+  return d;
+}
+
+void warp_dict_free(warp_dict_t *d) {
+  if (!d) return;
+#ifdef HAVE_ZSTD
+  ZSTD_freeCDict(d->cdict);
+  ZSTD_freeDDict(d->ddict);
+#endif
+  free(d->buf);
+  free(d);
+}
+
+uint32_t warp_dict_id(const warp_dict_t *d) { return d->id; }
+
+/* ---------- per-thread contexts ---------- */
+
+#ifdef HAVE_ZSTD
+typedef struct {
+  ZSTD_CCtx *c, *pc; /* dictionary / prefix mode (sticky parameters) */
+  ZSTD_DCtx *d, *pd;
+} dict_tls_t;
+
+static pthread_key_t  tls_key;
+static pthread_once_t tls_once = PTHREAD_ONCE_INIT;
+
+static void tls_free(void *p) {
+  dict_tls_t *t = (dict_tls_t*)p;
+  ZSTD_freeCCtx(t->c);
+  ZSTD_freeCCtx(t->pc);
+  ZSTD_freeDCtx(t->d);
+  ZSTD_freeDCtx(t->pd);
+  free(t);
+}
+
+static void tls_init(void) { pthread_key_create(&tls_key, tls_free); }
+
+static dict_tls_t *tls_get(void) {
+  pthread_once(&tls_once, tls_init);
+  dict_tls_t *t = (dict_tls_t*)pthread_getspecific(tls_key);
+  if (!t) {
+    t = (dict_tls_t*)calloc(1, sizeof(*t));
+    if (!t || pthread_setspecific(tls_key, t) != 0) { free(t); return NULL; }
+  }
+  return t;
+}
+#endif
+
+size_t warp_dict_compress(const warp_dict_t *d, void *dst, size_t cap, const void *src, size_t n) {
+#ifdef HAVE_ZSTD
+  dict_tls_t *t = tls_get();
+  if (!t || !d->cdict || (!t->c && !(t->c = ZSTD_createCCtx()))) return 0;
+  size_t r = ZSTD_compress_usingCDict(t->c, dst, cap, src, n, d->cdict);
+  return ZSTD_isError(r) ? 0 : r;
+#else
+  (void)d; (void)dst; (void)cap; (void)src; (void)n;
+  return 0;
+#endif
+}
+
+size_t warp_dict_decompress(const warp_dict_t *d, void *dst, size_t cap, const void *src, size_t n) {
+#ifdef HAVE_ZSTD
+  dict_tls_t *t = tls_get();
+  if (!t || (!t->d && !(t->d = ZSTD_createDCtx()))) return 0;
+  size_t r = ZSTD_decompress_usingDDict(t->d, dst, cap, src, n, d->ddict);
+  return ZSTD_isError(r) ? 0 : r;
+#else
+  (void)d; (void)dst; (void)cap; (void)src; (void)n;
+  return 0;
+#endif
+}
+
+/* ---------- chunk prefixes ---------- */
+
+#define WARP_PREFIX_WLOG_MIN 10
+#define WARP_PREFIX_WLOG_MAX 30
+
+#ifdef HAVE_ZSTD
+static int window_log(size_t bytes) {
+  int w = WARP_PREFIX_WLOG_MIN;
+  while (w < WARP_PREFIX_WLOG_MAX && ((size_t)1 << w) < bytes) w++;
+  return w;
+}
+#endif
+
+size_t warp_prefix_compress(void *dst, size_t cap, const void *src, size_t n,
+                            const void *prefix, size_t plen, int level) {
+#ifdef HAVE_ZSTD
+  dict_tls_t *t = tls_get();
+  if (!t || (!t->pc && !(t->pc = ZSTD_createCCtx()))) return 0;
+  ZSTD_CCtx *c = t->pc;
+  if (ZSTD_isError(ZSTD_CCtx_setParameter(c, ZSTD_c_compressionLevel, level)) ||
+      ZSTD_isError(ZSTD_CCtx_setParameter(c, ZSTD_c_enableLongDistanceMatching, 1)) ||
+      ZSTD_isError(ZSTD_CCtx_setParameter(c, ZSTD_c_windowLog, window_log(plen + n))) ||
+      ZSTD_isError(ZSTD_CCtx_refPrefix(c, prefix, plen))) return 0;
+  size_t r = ZSTD_compress2(c, dst, cap, src, n);
+  return ZSTD_isError(r) ? 0 : r;
+#else
+  (void)dst; (void)cap; (void)src; (void)n; (void)prefix; (void)plen; (void)level;
+  return 0;
+#endif
+}
+
+size_t warp_prefix_decompress(void *dst, size_t cap, const void *src, size_t n,
+                              const void *prefix, size_t plen) {
+#ifdef HAVE_ZSTD
+  dict_tls_t *t = tls_get();
+  if (!t) return 0;
+  if (!t->pd) {
+    if (!(t->pd = ZSTD_createDCtx())) return 0;
+    ZSTD_DCtx_setParameter(t->pd, ZSTD_d_windowLogMax, WARP_PREFIX_WLOG_MAX);
+  }
+  if (ZSTD_isError(ZSTD_DCtx_refPrefix(t->pd, prefix, plen))) return 0;
+  size_t r = ZSTD_decompressDCtx(t->pd, dst, cap, src, n);
+  return ZSTD_isError(r) ? 0 : r;
+#else
+  (void)dst; (void)cap; (void)src; (void)n; (void)prefix; (void)plen;
+  return 0;
+#endif
+}
+
+/* ---------- WDCT block ---------- */
+
+uint64_t warp_dict_block_size(const warp_dict_t *d) {
+  return d ? sizeof(wdct_header_t) + d->len : 0;
+}
+
+int warp_dict_fwrite(FILE *fout, const warp_dict_t *d) {
+  wdct_header_t h = { WDCT_MAGIC, d->id, (uint32_t)d->len, 0 };
+  return (fwrite(&h, sizeof(h), 1, fout) == 1 && fwrite(d->buf, d->len, 1, fout) == 1) ? 0 : -1;
+}
+
+warp_dict_t *warp_dict_fread(FILE *fin, int level) {
+  wdct_header_t h;
+  if (fread(&h, sizeof(h), 1, fin) != 1 || h.magic != WDCT_MAGIC || !h.size || h.size > WARP_DICT_MAX) return NULL;
+  void *buf = malloc(h.size);
+  warp_dict_t *d = (buf && fread(buf, 1, h.size, fin) == h.size) ? warp_dict_create(buf, h.size, level) : NULL;
+  free(buf);
+  return d;
+}
+
+warp_dict_t *warp_dict_pread(int fd, uint64_t off, int level) {
+  wdct_header_t h;
+  if (pread_all(fd, &h, sizeof(h), (off_t)off) != 0 || h.magic != WDCT_MAGIC || !h.size || h.size > WARP_DICT_MAX) return NULL;
+  void *buf = malloc(h.size);
+  warp_dict_t *d = (buf && pread_all(fd, buf, h.size, (off_t)(off + sizeof(h))) == 0) ? warp_dict_create(buf, h.size, level) : NULL;
+  free(buf);
+  return d;
+}
+
+/* ---------- training ---------- */
+
+#ifdef HAVE_ZSTD
+static double now_secs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* Compresses and decompresses every sample, with d or without; prints one line. */
+static int bench_samples(const char *label, const warp_dict_t *d, int level, const unsigned char *all,
+                         const size_t *lens, size_t n, size_t total) {
+  size_t cap = 0;
+  for (size_t i = 0; i < n; i++) cap += ZSTD_compressBound(lens[i]);
+  unsigned char *comp = (unsigned char*)malloc(cap);
+  size_t *clen = (size_t*)malloc(n * sizeof(*clen));
+  unsigned char *back = (unsigned char*)malloc(WARP_TRAIN_SAMPLE);
+  ZSTD_CCtx *cc = ZSTD_createCCtx();
+  ZSTD_DCtx *dc = ZSTD_createDCtx();
+  int rc = (comp && clen && back && cc && dc) ? 0 : -1;
+
+  size_t ctotal = 0;
+  unsigned creps = 0, dreps = 0;
+  double t0 = now_secs(), cdt = 0.0, ddt = 0.0;
+  while (!rc && (creps == 0 || (cdt = now_secs() - t0) < 0.2)) {
+    const unsigned char *src = all;
+    unsigned char *dst = comp;
+    ctotal = 0;
+    for (size_t i = 0; i < n && !rc; i++) {
+      size_t bound = ZSTD_compressBound(lens[i]);
+      size_t r = d ? ZSTD_compress_usingCDict(cc, dst, bound, src, lens[i], d->cdict)
+                   : ZSTD_compressCCtx(cc, dst, bound, src, lens[i], level);
+      if (ZSTD_isError(r)) rc = -1;
+      clen[i] = r;
+      ctotal += r;
+      src += lens[i]; dst += bound;
+    }
+    creps++;
+  }
+  t0 = now_secs();
+  while (!rc && (dreps == 0 || (ddt = now_secs() - t0) < 0.2)) {
+    const unsigned char *src = comp;
+    for (size_t i = 0; i < n && !rc; i++) {
+      size_t r = d ? ZSTD_decompress_usingDDict(dc, back, WARP_TRAIN_SAMPLE, src, clen[i], d->ddict)
+                   : ZSTD_decompressDCtx(dc, back, WARP_TRAIN_SAMPLE, src, clen[i]);
+      if (ZSTD_isError(r) || r != lens[i]) rc = -1;
+      src += ZSTD_compressBound(lens[i]);
+    }
+    dreps++;
+  }
+  if (!rc) {
+    const double mib = (double)total / (1024.0 * 1024.0);
+    fprintf(stderr, "%-8s %zu -> %zu bytes (%.2fx)  compress %8.1f MB/s  decompress %8.1f MB/s\n",
+            label, total, ctotal, ctotal ? (double)total / (double)ctotal : 0.0,
+            mib * creps / (cdt > 1e-9 ? cdt : 1e-9), mib * dreps / (ddt > 1e-9 ? ddt : 1e-9));
+  }
+  ZSTD_freeCCtx(cc);
+  ZSTD_freeDCtx(dc);
+  free(back); free(clen); free(comp);
+  return rc;
+}
+#endif
+
+int warp_train_dict(const char *dict_path, const char *const *samples, int nsamples,
+                    size_t dict_bytes, int level, int verbose) {
+#ifdef HAVE_ZSTD
+  if (!dict_bytes) dict_bytes = WARP_DICT_DEFAULT;
+  if (level <= 0) level = 3;
+
+  /* all samples back to back; files larger than WARP_TRAIN_SAMPLE are cut up */
+  size_t total = 0, n = 0, ncap = 0;
+  for (int i = 0; i < nsamples; i++) {
+    uint64_t sz = 0;
+    if (file_stat_size(samples[i], &sz) != 0) { perror(samples[i]); return 1; }
+    total += (size_t)sz;
+    ncap += (size_t)(sz + WARP_TRAIN_SAMPLE - 1) / WARP_TRAIN_SAMPLE;
+  }
+  unsigned char *all = (unsigned char*)malloc(total ? total : 1);
+  size_t *lens = (size_t*)malloc((ncap ? ncap : 1) * sizeof(*lens));
+  if (!all || !lens) { free(all); free(lens); fprintf(stderr, "OOM\n"); return 3; }
+  size_t pos = 0;
+  for (int i = 0; i < nsamples; i++) {
+    FILE *f = fopen(samples[i], "rb");
+    if (!f) { perror(samples[i]); free(all); free(lens); return 1; }
+    size_t r;
+    while (pos < total && (r = fread(all + pos, 1, total - pos < WARP_TRAIN_SAMPLE ? total - pos : WARP_TRAIN_SAMPLE, f)) > 0) {
+      lens[n++] = r;
+      pos += r;
+    }
+    fclose(f);
+  }
+  total = pos;
+
+  void *dict = malloc(dict_bytes);
+  size_t got = dict ? ZDICT_trainFromBuffer(dict, dict_bytes, all, lens, (unsigned)n) : 0;
+  if (!dict || ZDICT_isError(got)) {
+    fprintf(stderr, "training failed: %s\n", dict ? ZDICT_getErrorName(got) : "OOM");
+    free(dict); free(all); free(lens);
+    return 2;
+  }
+  int rc = 0;
+  FILE *f = fopen(dict_path, "wb");
+  if (!f || fwrite(dict, 1, got, f) != got) { perror(dict_path); rc = 2; }
+  if (f && fclose(f) != 0 && !rc) { perror(dict_path); rc = 2; }
+
+  warp_dict_t *d = rc ? NULL : warp_dict_create(dict, got, level);
+  if (!rc && d) {
+    if (verbose) fprintf(stderr, "dictionary %s: %zu bytes, id %u, from %zu samples (%zu bytes)\n",
+                         dict_path, got, (unsigned)d->id, n, total);
+    fprintf(stderr, "zstd level %d on the training samples:\n", level);
+    if (bench_samples("no dict", NULL, level, all, lens, n, total) != 0 ||
+        bench_samples("dict", d, level, all, lens, n, total) != 0) fprintf(stderr, "benchmark failed\n");
+  }
+  warp_dict_free(d);
+  free(dict); free(all); free(lens);
+  return rc;
+#else
+  (void)dict_path; (void)samples; (void)nsamples; (void)dict_bytes; (void)level; (void)verbose;
+  fprintf(stderr, "zstd support not built in\n");
+  return 1;
+#endif
+}
@@ -4,36 +4,79 @@
 #include <string.h>
 #include <stdint.h>
 #include <errno.h>
-#include <unistd.h>   /* sysconf, unlink */
+#include <unistd.h>   /* sysconf, unlink, pipe */
+#include <time.h>
+#include <stdatomic.h>
 
 #include "warpc/container.h"
+#include "warpc/warp.h"
 #include "warpc/codecs.h"
 #include "warpc/threadpool.h"
 #include "warpc/bufpool.h"
 #include "warpc/util.h"
+#include "warpc/aio.h"
+
+/* Input/output backends (--io) */
+enum { IO_MMAP = 0, IO_PREAD = 1, IO_URING = 2 };
 
 typedef struct {
   const codec_vtable* vt;
   int    codec_id;
   int    level;
   size_t chunk_kib;
+  int    chunk_auto;    /* no --chunk-kib: compress may use smaller chunks to fill the threads */
+  int    codec_workers; /* codec threads per chunk when chunks < threads (zstd), 0 = off */
+  size_t codec_job;     /* bytes per codec-internal job */
   int    threads;
   int    verify;   /* round-trip check */
   int    verbose;
+  int    io;       /* IO_*: how chunk data is read and written */
+  uint64_t offset;    /* cat: first byte */
+  uint64_t length;    /* cat: 0 = to end */
+  size_t   cache_mib; /* cat: decoded-chunk cache */
+  size_t   dict_kib;  /* train: dictionary size, 0 = default */
+  const char* const* samples; /* train: sample files */
+  int      nsamples;
+  int      v3_auto;   /* archive/append: --codec auto, codec picked per chunk (profile or trials) */
+  int      cdc;       /* archive: content-defined chunks + dedup */
+  int      prefix_group; /* archive/append: zstd chunks reference the first of each N, 0 = off */
+  const char* dict;   /* archive/append: zstd dictionary (warpc train) */
+  const char* const* members; /* extract: selected members, none = all */
+  int      nmembers;
 } warpc_opts;
 
 static void usage(const char* argv0) {
   fprintf(stderr,
     "Usage:\n"
-    "  %s compress  [--codec zstd|lz4|throughput] [--level N] [--chunk-kib N] [--threads N] [--verify] [--verbose] <in> <out.warp>\n"
-    "  %s decompress [--threads N] [--verbose] <in.warp> <out>\n"
+    "  %s compress  [--codec zstd|lz4|throughput] [--level N] [--chunk-kib N] [--threads N] [--io mmap|pread|uring] [--verify] [--verbose] <in> <out.warp>\n"
+    "  %s decompress [--threads N] [--io mmap|pread|uring] [--verbose] <in.warp> <out>\n"
+    "  %s cat [--offset N] [--length N] [--cache-mib N] <in.warp>   (WARP v3, to stdout)\n"
+    "  %s bench [--codec ...] [--level N] [--chunk-kib N] [--threads N] <in>   (pread vs mmap vs uring)\n"
+    "  %s calibrate [--verbose] [<profile>]   (codec speed/ratio profile for WARP v3 auto mode)\n"
+    "  %s train [--dict-kib N] [--level N] [--verbose] <out.dict> <sample>...   (zstd dictionary for WARP v3)\n"
+    "  %s archive [--codec zstd|lz4|auto] [--level N] [--chunk-kib N] [--threads N] [--cdc] [--prefix-group N] [--dict <file>] [--verbose] <dir> <out.warp>\n"
+    "  %s extract [--verbose] <in.warp> <dest-dir> [<member>...]\n"
+    "  %s list <in.warp>   (WARP v3 archives)\n"
+    "  %s append [--codec zstd|lz4|auto] [--level N] [--threads N] [--cdc] [--prefix-group N] [--dict <file>] [--verbose] <in> <file.warp>   (new bytes of a grown file)\n"
+    "  %s compact [--verbose] <file.warp>   (fold appended segments into one table)\n"
     "\n"
+    "Use '-' for <in>/<out> to stream from stdin / to stdout.\n"
     "Defaults: --codec zstd, --level zstd:3 lz4:0, --chunk-kib 16384, --threads=CPU\n"
-    "Preset  : --codec throughput ⇒ lz4 @ large chunks\n",
-    argv0, argv0);
+    "Preset  : --codec throughput ⇒ lz4 @ large chunks\n"
+    "Auto    : archive/append --codec auto picks a codec per chunk from the profile (warpc calibrate), else by trials\n"
+    "Prefix  : --prefix-group N compresses zstd chunks against the first chunk of each group of N;\n"
+    "          better ratio on similar chunks, but a random read of a later chunk decodes two chunks\n"
+    "Profile : $WARPC_PROFILE, else $XDG_CONFIG_HOME/warpc/profile, else ~/.config/warpc/profile\n",
+    argv0, argv0, argv0, argv0, argv0, argv0, argv0, argv0, argv0, argv0, argv0);
 }
 
 static int do_decompress(const char* in, const char* out, const warpc_opts* o); /* fwd */
+static int compress_uring(int fd_in, int fd_out, uint64_t fsize, size_t chunk, size_t bound, const warpc_opts* o); /* fwd */
+
+static int is_stdio(const char* path) { return strcmp(path, "-") == 0; }
+
+static int open_in(const char* path)  { return is_stdio(path) ? STDIN_FILENO  : file_open_rd(path); }
+static int open_out(const char* path) { return is_stdio(path) ? STDOUT_FILENO : file_open_trunc(path); }
 
 static int autodetect_threads(void) {
   long n = sysconf(_SC_NPROCESSORS_ONLN);
@@ -54,31 +97,59 @@ static int parse_args(int argc, char** argv, int* is_compress, warpc_opts* o, co
   if (argc < 2) { usage(argv[0]); return -1; }
   *is_compress = (strcmp(argv[1], "compress") == 0);
   int is_decompress = (strcmp(argv[1], "decompress") == 0);
-  if (!*is_compress && !is_decompress) { usage(argv[0]); return -1; }
+  int is_cat = (strcmp(argv[1], "cat") == 0);
+  int is_bench = (strcmp(argv[1], "bench") == 0);
+  int is_calibrate = (strcmp(argv[1], "calibrate") == 0);
+  int is_train = (strcmp(argv[1], "train") == 0);
+  int is_archive = (strcmp(argv[1], "archive") == 0);
+  int is_extract = (strcmp(argv[1], "extract") == 0);
+  int is_list = (strcmp(argv[1], "list") == 0);
+  int is_append = (strcmp(argv[1], "append") == 0);
+  int is_compact = (strcmp(argv[1], "compact") == 0);
+  if (!*is_compress && !is_decompress && !is_cat && !is_bench && !is_calibrate && !is_train &&
+      !is_archive && !is_extract && !is_list && !is_append && !is_compact) { usage(argv[0]); return -1; }
 
   o->vt = warpc_get_codec_by_name("zstd");
   o->codec_id = warpc_codec_id_from_name("zstd");
   o->level = WARPC_DEFAULT_LEVEL_ZSTD;
   o->chunk_kib = WARPC_DEFAULT_CHUNK_KIB;
+  o->chunk_auto = 1;
+  o->codec_workers = 0;
+  o->codec_job = 0;
   o->threads = autodetect_threads();
   o->verify = 0;
   o->verbose = 0;
+  o->io = IO_MMAP;
+  o->offset = 0;
+  o->length = 0;
+  o->cache_mib = 64;
+  o->dict_kib = 0;
+  o->samples = NULL;
+  o->nsamples = 0;
+  o->v3_auto = 0;
+  o->cdc = 0;
+  o->prefix_group = 0;
+  o->dict = NULL;
+  o->members = NULL;
+  o->nmembers = 0;
 
   int i = 2;
   while (i < argc) {
     if (strcmp(argv[i], "--codec") == 0 && i+1 < argc) {
       const char* c = argv[++i];
       if (strcmp(c, "throughput") == 0) { apply_preset("throughput", o); }
+      else if (strcmp(c, "auto") == 0 && (is_archive || is_append)) { o->v3_auto = 1; }
       else {
         const codec_vtable* vt = warpc_get_codec_by_name(c);
         int id = warpc_codec_id_from_name(c);
         if (!vt || id == 0) { fprintf(stderr, "Unknown/disabled codec '%s'\n", c); return -1; }
-        o->vt = vt; o->codec_id = id;
+        o->vt = vt; o->codec_id = id; o->v3_auto = 0;
       }
     } else if (strcmp(argv[i], "--level") == 0 && i+1 < argc) {
       o->level = atoi(argv[++i]);
     } else if (strcmp(argv[i], "--chunk-kib") == 0 && i+1 < argc) {
       o->chunk_kib = (size_t)atol(argv[++i]);
+      o->chunk_auto = 0;
     } else if (strcmp(argv[i], "--threads") == 0 && i+1 < argc) {
       o->threads = atoi(argv[++i]);
       if (o->threads <= 0) o->threads = autodetect_threads();
@@ -86,138 +157,1002 @@ static int parse_args(int argc, char** argv, int* is_compress, warpc_opts* o, co
       o->verify = 1;
     } else if (strcmp(argv[i], "--verbose") == 0) {
       o->verbose = 1;
+    } else if (strcmp(argv[i], "--no-mmap") == 0) {
+      o->io = IO_PREAD;
+    } else if (strcmp(argv[i], "--io") == 0 && i+1 < argc) {
+      const char* m = argv[++i];
+      if      (strcmp(m, "mmap")  == 0) o->io = IO_MMAP;
+      else if (strcmp(m, "pread") == 0) o->io = IO_PREAD;
+      else if (strcmp(m, "uring") == 0) o->io = IO_URING;
+      else { fprintf(stderr, "Unknown --io backend '%s'\n", m); return -1; }
+    } else if (strcmp(argv[i], "--offset") == 0 && i+1 < argc) {
+      o->offset = strtoull(argv[++i], NULL, 0);
+    } else if (strcmp(argv[i], "--length") == 0 && i+1 < argc) {
+      o->length = strtoull(argv[++i], NULL, 0);
+    } else if (strcmp(argv[i], "--cache-mib") == 0 && i+1 < argc) {
+      o->cache_mib = (size_t)atol(argv[++i]);
+    } else if (strcmp(argv[i], "--dict-kib") == 0 && i+1 < argc) {
+      o->dict_kib = (size_t)atol(argv[++i]);
+    } else if (strcmp(argv[i], "--cdc") == 0) {
+      o->cdc = 1;
+    } else if (strcmp(argv[i], "--prefix-group") == 0 && i+1 < argc) {
+      o->prefix_group = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--dict") == 0 && i+1 < argc) {
+      o->dict = argv[++i];
     } else {
       break;
     }
     ++i;
   }
+  if (is_train) {
+    if (argc - i < 2) { usage(argv[0]); return -1; }
+    *in = NULL; *out = argv[i];
+    o->samples = (const char* const*)(argv + i + 1);
+    o->nsamples = argc - i - 1;
+    return 6;
+  }
+  if (is_extract) {
+    if (argc - i < 2) { usage(argv[0]); return -1; }
+    *in = argv[i]; *out = argv[i+1];
+    o->members = (const char* const*)(argv + i + 2);
+    o->nmembers = argc - i - 2;
+    return 8;
+  }
+  if (is_list || is_compact) {
+    if (argc - i != 1) { usage(argv[0]); return -1; }
+    *in = argv[i]; *out = "-";
+    return is_list ? 9 : 11;
+  }
+  if (is_calibrate) {
+    if (argc - i > 1) { usage(argv[0]); return -1; }
+    *in = NULL; *out = argc - i == 1 ? argv[i] : NULL;
+    return 5;
+  }
+  if (is_cat || is_bench) {
+    if (argc - i != 1 || (is_bench && is_stdio(argv[i]))) { usage(argv[0]); return -1; }
+    *in = argv[i]; *out = "-";
+    return is_cat ? 3 : 4;
+  }
   if (argc - i != 2) { usage(argv[0]); return -1; }
   *in = argv[i]; *out = argv[i+1];
+  if (is_archive) return 7;
+  if (is_append) {
+    if (is_stdio(*in) || is_stdio(*out)) { fprintf(stderr, "append needs file paths, not '-'\n"); return -1; }
+    return 10;
+  }
   return *is_compress ? 1 : 2;
 }
 
 /* ---------------- Compression / Decompression ---------------- */
 
+/*
+ * Compression pipeline: workers pread + compress chunks in parallel while the
+ * main thread writes finished records strictly in input order. At most
+ * `depth` chunks are in flight, each owning one input and one output buffer,
+ * so memory stays at ~depth * (chunk + bound) regardless of file size.
+ *
+ * Streaming input (stdin/pipe) is read sequentially by the main thread
+ * instead; the header then carries WARPC_SIZE_STREAM and the records end
+ * with a [0][0] terminator. Seekable input is mapped when possible so the
+ * codec reads the page cache directly and no input buffers are needed.
+ *
+ * --verify decodes each chunk again on the worker that compressed it, into a
+ * scratch buffer from a third pool, and compares it with the source bytes.
+ */
+typedef struct cpipe cpipe;
+
+typedef struct {
+  cpipe*  pp;
+  void*   ibuf;
+  void*   obuf;
+  off_t   in_off;
+  size_t  in_len;
+  void*   vbuf;    /* --verify scratch, or NULL */
+  size_t  out_len; /* 0 = failed */
+  int     bad;     /* round trip did not reproduce the input */
+  int     done;
+} cjob;
+
+struct cpipe {
+  const warpc_opts* o;
+  int             fd_in;
+  int             stream;  /* main thread fills ibuf; no pread */
+  const unsigned char* map; /* whole-input mapping, or NULL */
+  size_t          bound;
+  atomic_int      abort;   /* set by the main thread on error; workers skip the rest */
+  pthread_mutex_t mtx;
+  pthread_cond_t  cv;
+};
+
+/* Chunk compression on a worker; applies the hybrid plan to the thread's context. */
+static size_t chunk_compress(const warpc_opts* o, const void* src, size_t n, void* dst, size_t cap) {
+  if (o->codec_workers) warpc_codec_set_workers(o->vt, o->codec_workers, o->codec_job);
+  return warpc_codec_compress(o->vt, src, n, dst, cap, o->level);
+}
+
+/* Decodes a compressed chunk into scratch; 0 when it reproduces src exactly. */
+static int chunk_roundtrip(const warpc_opts* o, const void* src, size_t n, const void* comp, size_t clen, void* scratch) {
+  if (warpc_codec_decompress(o->vt, comp, clen, scratch, n) != n) return -1;
+  return memcmp(scratch, src, n) != 0;
+}
+
+/*
+ * Hybrid scheduling: a file with fewer chunks than threads would leave
+ * workers idle (a 100 MB file is 7 default chunks). zstd then runs
+ * threads/chunks codec-internal workers per chunk; other codecs get smaller
+ * chunks instead, unless --chunk-kib was given. The format is unchanged.
+ */
+#define WARPC_SPLIT_MIN_KIB 1024
+
+static void plan_hybrid(warpc_opts* o, uint64_t fsize) {
+  const uint64_t chunk = (uint64_t)o->chunk_kib * 1024;
+  const uint64_t nchunks = chunk ? (fsize + chunk - 1) / chunk : 0;
+  if (o->threads <= 1 || nchunks == 0 || nchunks >= (uint64_t)o->threads) return;
+  int workers = o->threads / (int)nchunks;
+  if (workers >= 2 && warpc_codec_set_workers(o->vt, workers, (size_t)(chunk / (uint64_t)workers)) == 0) {
+    warpc_codec_set_workers(o->vt, 0, 0); /* that was a probe on the main thread */
+    o->codec_workers = workers;
+    o->codec_job = (size_t)(chunk / (uint64_t)workers);
+    if (o->verbose) fprintf(stderr, "hybrid: %llu chunks, %d %s workers each\n", (unsigned long long)nchunks, workers, o->vt->name);
+  } else if (o->chunk_auto) {
+    uint64_t kib = (fsize / (uint64_t)o->threads + 1023) / 1024;
+    kib = (kib + WARPC_SPLIT_MIN_KIB - 1) / WARPC_SPLIT_MIN_KIB * WARPC_SPLIT_MIN_KIB;
+    if (kib >= o->chunk_kib) return;
+    o->chunk_kib = (size_t)kib;
+    if (o->verbose) fprintf(stderr, "hybrid: %llu chunks < %d threads, chunk size %zu KiB\n", (unsigned long long)nchunks, o->threads, o->chunk_kib);
+  }
+}
+
+static void cjob_run(void* arg) {
+  cjob* j = (cjob*)arg;
+  cpipe* pp = j->pp;
+  const void* src = NULL;
+  size_t got = 0;
+  int bad = 0;
+  if (atomic_load(&pp->abort)) {
+    /* leave got = 0 */
+  } else if (pp->map) {
+    src = pp->map + j->in_off;
+  } else if (pp->stream || pread_all(pp->fd_in, j->ibuf, j->in_len, j->in_off) == 0) {
+    src = j->ibuf;
+  }
+  if (src) got = chunk_compress(pp->o, src, j->in_len, j->obuf, pp->bound);
+  if (got && j->vbuf) bad = chunk_roundtrip(pp->o, src, j->in_len, j->obuf, got, j->vbuf) != 0;
+  pthread_mutex_lock(&pp->mtx);
+  j->out_len = got;
+  j->bad = bad;
+  j->done = 1;
+  pthread_cond_broadcast(&pp->cv);
+  pthread_mutex_unlock(&pp->mtx);
+}
+
 static int do_compress(const char* in, const char* out, const warpc_opts* o) {
   if (!o->vt) { fprintf(stderr, "No codec available.\n"); return 1; }
 
+  const int stream = is_stdio(in);
   uint64_t fsize = 0;
-  if (file_stat_size(in, &fsize) != 0) { perror("stat"); return 1; }
-  int fd_in = file_open_rd(in); if (fd_in < 0) { perror("open input"); return 1; }
-  int fd_out = file_open_trunc(out); if (fd_out < 0) { perror("open output"); close(fd_in); return 1; }
+  if (!stream && file_stat_size(in, &fsize) != 0) { perror("stat"); return 1; }
+  warpc_opts plan = *o;
+  if (!stream) plan_hybrid(&plan, fsize);
+  o = &plan;
+  int fd_in = open_in(in); if (fd_in < 0) { perror("open input"); return 1; }
+  int fd_out = open_out(out); if (fd_out < 0) { perror("open output"); close(fd_in); return 1; }
 
   warpc_header hdr = {0};
   hdr.magic = WARPC_MAGIC;
   hdr.version = WARPC_VERSION;
   hdr.codec = (uint16_t)o->codec_id;
   hdr.chunk_size_k = (uint32_t)o->chunk_kib;
-  hdr.orig_size = fsize;
+  hdr.orig_size = stream ? WARPC_SIZE_STREAM : fsize;
 
   if (write_all(fd_out, &hdr, sizeof(hdr)) != 0) { perror("write header"); close(fd_in); close(fd_out); return 1; }
 
   size_t chunk = o->chunk_kib * 1024;
-  struct bufpool* inpool  = pool_create((size_t)o->threads + 2, chunk);
-  struct bufpool* outpool = pool_create((size_t)o->threads + 2, chunk * 2); /* dst bound ≈ bigger */
-  if (!inpool || !outpool) { fprintf(stderr, "OOM: buffers\n"); close(fd_in); close(fd_out); return 1; }
-
-  uint64_t remaining = fsize;
-  off_t in_off = 0;
-
-  while (remaining > 0) {
-    size_t this_in = (remaining > chunk) ? chunk : (size_t)remaining;
-    void* ibuf = pool_acquire(inpool);
-    if (!ibuf) { ibuf = malloc(chunk); if (!ibuf) { fprintf(stderr, "OOM\n"); break; } }
-    if (pread_all(fd_in, ibuf, this_in, in_off) != 0) { perror("pread"); free(ibuf); break; }
-    in_off += (off_t)this_in;
-    remaining -= (uint64_t)this_in;
-
-    size_t bound = 0;
-    if (o->vt->compress_bound(this_in, &bound) != 0 || bound == 0) bound = this_in + (this_in / 16) + 64;
-    void* obuf = pool_acquire(outpool);
-    if (!obuf || bound > outpool->bufsz) { if (obuf) pool_release(outpool, obuf); obuf = malloc(bound); if (!obuf) { fprintf(stderr, "OOM\n"); free(ibuf); break; } }
-
-    size_t got = o->vt->compress(ibuf, this_in, obuf, bound, o->level);
-    if (got == 0) {
+  size_t bound = 0;
+  if (o->vt->compress_bound(chunk, &bound) != 0 || bound == 0) bound = chunk + (chunk / 16) + 64;
+
+  if (o->io == IO_URING && !stream && !is_stdio(out) && fsize > 0) {
+    int urc = compress_uring(fd_in, fd_out, fsize, chunk, bound, o);
+    if (urc >= 0) { close(fd_in); close(fd_out); return urc; }
+    if (o->verbose) fprintf(stderr, "io_uring unavailable, using blocking I/O\n");
+  }
+
+  const unsigned char* map = (stream || o->io != IO_MMAP) ? NULL : (const unsigned char*)file_map_rd(fd_in, fsize);
+  size_t depth = (size_t)o->threads * 2; /* chunks in flight */
+  struct bufpool* inpool  = map ? NULL : pool_create(depth, chunk);
+  struct bufpool* outpool = pool_create(depth, bound);
+  struct bufpool* vpool   = o->verify ? pool_create(depth, chunk) : NULL;
+  cjob* jobs = (cjob*)calloc(depth, sizeof(*jobs));
+  cpipe pp = { o, fd_in, stream, map, bound, 0, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER };
+  struct threadpool* tp = ((inpool || map) && outpool && (vpool || !o->verify) && jobs) ? tp_create((size_t)o->threads) : NULL;
+  if (!tp) {
+    fprintf(stderr, "OOM: buffers\n");
+    pool_destroy(inpool); pool_destroy(outpool); pool_destroy(vpool); free(jobs); file_unmap(map, fsize);
+    close(fd_in); close(fd_out); return 1;
+  }
+
+  uint64_t nchunks = (fsize + chunk - 1) / chunk;
+  uint64_t issued = 0, written = 0;
+  int rc = 0, eof = 0;
+
+  for (;;) {
+    /* keep the window full */
+    while (!eof && issued - written < depth) {
+      cjob* j = &jobs[issued % depth];
+      uint64_t off = issued * (uint64_t)chunk;
+      if (!stream && issued == nchunks) { eof = 1; break; }
+      j->pp = &pp;
+      j->in_off = (off_t)off;
+      j->in_len = (fsize - off > chunk) ? chunk : (size_t)(fsize - off);
+      j->ibuf = map ? NULL : pool_acquire_wait(inpool, -1);
+      j->obuf = pool_acquire_wait(outpool, -1);
+      j->vbuf = vpool ? pool_acquire_wait(vpool, -1) : NULL;
+      j->out_len = 0;
+      j->bad = 0;
+      j->done = 0;
+      if ((!j->ibuf && !map) || !j->obuf || (vpool && !j->vbuf)) {
+        fprintf(stderr, "OOM\n");
+        pool_release(inpool, j->ibuf); pool_release(outpool, j->obuf); pool_release(vpool, j->vbuf);
+        rc = 1; break;
+      }
+      if (stream) {
+        ssize_t r = read_upto(fd_in, j->ibuf, chunk);
+        if (r <= 0) {
+          if (r < 0) { perror("read input"); rc = 1; }
+          pool_release(inpool, j->ibuf); pool_release(outpool, j->obuf); pool_release(vpool, j->vbuf);
+          eof = 1; break;
+        }
+        j->in_len = (size_t)r;
+      }
+      if (map) file_map_willneed(map, off, j->in_len);
+      if (tp_submit(tp, cjob_run, j) != 0) {
+        fprintf(stderr, "OOM\n");
+        pool_release(inpool, j->ibuf); pool_release(outpool, j->obuf); pool_release(vpool, j->vbuf);
+        rc = 1; break;
+      }
+      ++issued;
+    }
+    if (rc || written == issued) break;
+
+    /* drain the oldest chunk in order */
+    cjob* j = &jobs[written % depth];
+    pthread_mutex_lock(&pp.mtx);
+    while (!j->done) pthread_cond_wait(&pp.cv, &pp.mtx);
+    pthread_mutex_unlock(&pp.mtx);
+
+    if (j->out_len == 0) {
       fprintf(stderr, "Compression failed (codec=%s, level=%d). Check that the library is installed and enabled.\n", o->vt->name, o->level);
-      free(ibuf); free(obuf); close(fd_in); close(fd_out); pool_destroy(inpool); pool_destroy(outpool); return 1;
+      rc = 1; break;
+    }
+    if (j->bad) {
+      fprintf(stderr, "verify: chunk %llu does not round-trip (codec=%s)\n", (unsigned long long)written, o->vt->name);
+      rc = 1; break;
     }
 
-    uint64_t u = (uint64_t)this_in, c = (uint64_t)got;
+    uint64_t u = (uint64_t)j->in_len, c = (uint64_t)j->out_len;
     if (write_all(fd_out, &u, sizeof(u)) != 0 || write_all(fd_out, &c, sizeof(c)) != 0 ||
-        write_all(fd_out, obuf, got) != 0) {
+        write_all(fd_out, j->obuf, j->out_len) != 0) {
       perror("write chunk");
-      free(ibuf); free(obuf); break;
+      rc = 1; break;
     }
 
-    pool_release(inpool, ibuf);
-    pool_release(outpool, obuf);
+    pool_release(inpool, j->ibuf);
+    pool_release(outpool, j->obuf);
+    pool_release(vpool, j->vbuf);
+    ++written;
 
-    if (o->verbose) fprintf(stderr, "compressed %zu -> %zu bytes (%s)\n", this_in, got, o->vt->name);
+    if (o->verbose) fprintf(stderr, "compressed %zu -> %zu bytes (%s)\n", (size_t)u, (size_t)c, o->vt->name);
   }
 
+  if (!rc && stream) {
+    uint64_t term[2] = { 0, 0 };
+    if (write_all(fd_out, term, sizeof(term)) != 0) { perror("write trailer"); rc = 1; }
+  }
+
+  /* on error, let queued jobs bail out early; tp_destroy drains the queue */
+  atomic_store(&pp.abort, rc);
+  tp_destroy(tp);
+  if (o->verbose) {
+    struct bufpool_stats st;
+    pool_stats(outpool, &st);
+    fprintf(stderr, "buffers: %zu hits, %zu misses, %zu waits\n", st.hits, st.misses, st.waits);
+  }
+  for (; written < issued; ++written) {
+    pool_release(inpool, jobs[written % depth].ibuf);
+    pool_release(outpool, jobs[written % depth].obuf);
+    pool_release(vpool, jobs[written % depth].vbuf);
+  }
+  free(jobs);
   pool_destroy(inpool);
   pool_destroy(outpool);
+  pool_destroy(vpool);
+  file_unmap(map, fsize);
+  pthread_mutex_destroy(&pp.mtx);
+  pthread_cond_destroy(&pp.cv);
   close(fd_in); close(fd_out);
+  if (!rc && o->verify && o->verbose) fprintf(stderr, "verify: %llu chunks round-tripped\n", (unsigned long long)written);
+  return rc;
+}
+
+/*
+ * Parallel decoder: a pre-scan walks the 16-byte record headers (skipping
+ * payloads) to learn every chunk's input and output offset. Chunks are then
+ * independent, so workers pread, decode and pwrite each one straight to its
+ * final position; the main thread only keeps the number in flight bounded.
+ */
+typedef struct {
+  off_t    in_off;  /* payload offset in the container */
+  off_t    out_off; /* offset in the restored file */
+  uint64_t u, c;
+} drec;
+
+typedef struct dpipe dpipe;
+
+typedef struct {
+  dpipe*       pp;
+  const drec*  r;
+} djob;
+
+struct dpipe {
+  const codec_vtable* vt;
+  int              fd_in, fd_out;
+  const unsigned char* map; /* container mapping (indexed path), or NULL */
+  struct bufpool*  inpool;
+  struct bufpool*  outpool;
+  size_t           inflight;
+  atomic_int       failed;  /* set on the first error; later jobs skip their work */
+  pthread_mutex_t  mtx;
+  pthread_cond_t   cv;
+};
+
+static void djob_run(void* arg) {
+  djob* j = (djob*)arg;
+  dpipe* pp = j->pp;
+  const drec* r = j->r;
+  int ok = 0;
+  void* ibuf = pp->map ? NULL : pool_acquire_wait(pp->inpool, -1);
+  void* obuf = pool_acquire_wait(pp->outpool, -1);
+  const void* src = pp->map ? (const void*)(pp->map + r->in_off) : ibuf;
+  if (!atomic_load(&pp->failed) && src && obuf &&
+      (pp->map || pread_all(pp->fd_in, ibuf, (size_t)r->c, r->in_off) == 0) &&
+      warpc_codec_decompress(pp->vt, src, (size_t)r->c, obuf, (size_t)r->u) == (size_t)r->u &&
+      pwrite_all(pp->fd_out, obuf, (size_t)r->u, r->out_off) == 0) ok = 1;
+  pool_release(pp->inpool, ibuf);
+  pool_release(pp->outpool, obuf);
+  pthread_mutex_lock(&pp->mtx);
+  if (!ok) atomic_store(&pp->failed, 1);
+  pp->inflight--;
+  pthread_cond_broadcast(&pp->cv);
+  pthread_mutex_unlock(&pp->mtx);
+}
 
-  if (o->verify) {
-    char* tmp = (char*)malloc(strlen(out) + 8);
-    if (!tmp) return 0;
-    sprintf(tmp, "%s.out", out);
-    warpc_opts v = *o; v.verify = 0; v.verbose = 0;
-    if (do_decompress(out, tmp, &v) != 0) {
-      fprintf(stderr, "verify: decompress failed\n"); free(tmp); return 1;
+/* Walk record headers only; fills *out (caller frees) and the largest u/c seen.
+ * Streamed containers (orig_size == WARPC_SIZE_STREAM) end at the [0][0] record. */
+static int scan_records(int fd, uint64_t orig_size, uint64_t file_size,
+                        drec** out, size_t* count, uint64_t* max_u, uint64_t* max_c) {
+  size_t cap = 0, n = 0;
+  drec* recs = NULL;
+  off_t pos = (off_t)sizeof(warpc_header);
+  uint64_t done = 0;
+  *max_u = 0; *max_c = 0;
+  while (done < orig_size) {
+    uint64_t uc[2];
+    if (pread_all(fd, uc, sizeof(uc), pos) != 0) { free(recs); return -1; }
+    pos += (off_t)sizeof(uc);
+    if (orig_size == WARPC_SIZE_STREAM && uc[0] == 0 && uc[1] == 0) break; /* terminator */
+    if (uc[0] == 0 || uc[0] > orig_size - done || uc[1] > file_size - (uint64_t)pos) { free(recs); return -1; }
+    if (n == cap) {
+      size_t ncap = cap ? cap * 2 : 1024;
+      drec* nr = (drec*)realloc(recs, ncap * sizeof(*nr));
+      if (!nr) { free(recs); return -1; }
+      recs = nr; cap = ncap;
     }
-    uint64_t a = fnv1a64_file(in, 1<<20);
-    uint64_t b = fnv1a64_file(tmp, 1<<20);
-    if (a != b) {
-      fprintf(stderr, "verify: hash mismatch! (0x%016llx != 0x%016llx)\n",
-              (unsigned long long)a, (unsigned long long)b);
-      free(tmp); return 1;
+    recs[n].in_off = pos;
+    recs[n].out_off = (off_t)done;
+    recs[n].u = uc[0];
+    recs[n].c = uc[1];
+    ++n;
+    if (uc[0] > *max_u) *max_u = uc[0];
+    if (uc[1] > *max_c) *max_c = uc[1];
+    pos += (off_t)uc[1];
+    done += uc[0];
+  }
+  *out = recs; *count = n;
+  return 0;
+}
+
+/* Seekable input and output: decode from the pre-scanned index, pwrite in place. */
+static int decompress_indexed(int fd_in, int fd_out, uint64_t fsize, const warpc_header* hdr,
+                              const codec_vtable* vt, const warpc_opts* o) {
+  drec* recs = NULL;
+  size_t nrec = 0;
+  uint64_t max_u = 0, max_c = 0;
+  if (scan_records(fd_in, hdr->orig_size, fsize, &recs, &nrec, &max_u, &max_c) != 0) {
+    fprintf(stderr, "truncated or corrupt container\n"); return 1;
+  }
+
+  size_t depth = (size_t)o->threads * 2;
+  dpipe pp = { vt, fd_in, fd_out, NULL, NULL, NULL, 0, 0, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER };
+  pp.map     = o->io != IO_MMAP ? NULL : (const unsigned char*)file_map_rd(fd_in, fsize);
+  pp.inpool  = pp.map ? NULL : pool_create(depth, max_c ? (size_t)max_c : 1);
+  pp.outpool = pool_create(depth, max_u ? (size_t)max_u : 1);
+  djob* jobs = (djob*)calloc(nrec ? nrec : 1, sizeof(*jobs));
+  struct threadpool* tp = ((pp.inpool || pp.map) && pp.outpool && jobs) ? tp_create((size_t)o->threads) : NULL;
+  if (!tp) {
+    fprintf(stderr, "OOM\n");
+    pool_destroy(pp.inpool); pool_destroy(pp.outpool); free(jobs); free(recs); file_unmap(pp.map, fsize);
+    return 1;
+  }
+
+  for (size_t i = 0; i < nrec; ++i) {
+    pthread_mutex_lock(&pp.mtx);
+    while (pp.inflight >= depth && !atomic_load(&pp.failed)) pthread_cond_wait(&pp.cv, &pp.mtx);
+    int stop = atomic_load(&pp.failed);
+    if (!stop) pp.inflight++;
+    pthread_mutex_unlock(&pp.mtx);
+    if (stop) break;
+
+    jobs[i].pp = &pp;
+    jobs[i].r = &recs[i];
+    if (pp.map) file_map_willneed(pp.map, (uint64_t)recs[i].in_off, (size_t)recs[i].c);
+    if (tp_submit(tp, djob_run, &jobs[i]) != 0) {
+      pthread_mutex_lock(&pp.mtx); pp.inflight--; atomic_store(&pp.failed, 1); pthread_mutex_unlock(&pp.mtx);
+      break;
     }
-    if (o->verbose) fprintf(stderr, "verify: OK (FNV-1a 64)\n");
-    unlink(tmp);
-    free(tmp);
   }
 
+  pthread_mutex_lock(&pp.mtx);
+  while (pp.inflight > 0) pthread_cond_wait(&pp.cv, &pp.mtx);
+  pthread_mutex_unlock(&pp.mtx);
+  if (atomic_load(&pp.failed)) fprintf(stderr, "decompress failed (%s)\n", vt->name);
+  else if (o->verbose) {
+    uint64_t total = nrec ? (uint64_t)recs[nrec-1].out_off + recs[nrec-1].u : 0;
+    fprintf(stderr, "decompressed %zu chunks -> %llu bytes\n", nrec, (unsigned long long)total);
+  }
+
+  tp_destroy(tp);
+  free(jobs); free(recs);
+  file_unmap(pp.map, fsize);
+  pool_destroy(pp.inpool);
+  pool_destroy(pp.outpool);
+  pthread_mutex_destroy(&pp.mtx);
+  pthread_cond_destroy(&pp.cv);
+  return atomic_load(&pp.failed) ? 1 : 0;
+}
+
+/*
+ * Pipes on either side: the main thread reads records sequentially, workers
+ * decode them, and results are written back in record order. Buffers are
+ * sized from the header's chunk size, so memory stays bounded by the window.
+ */
+typedef struct {
+  dpipe*   pp;
+  void*    ibuf;
+  void*    obuf;
+  uint64_t u, c;
+  int      ok;
+  int      done;
+} sjob;
+
+static void sjob_run(void* arg) {
+  sjob* j = (sjob*)arg;
+  dpipe* pp = j->pp;
+  int ok = !atomic_load(&pp->failed) && warpc_codec_decompress(pp->vt, j->ibuf, (size_t)j->c, j->obuf, (size_t)j->u) == (size_t)j->u;
+  pthread_mutex_lock(&pp->mtx);
+  j->ok = ok;
+  j->done = 1;
+  pthread_cond_broadcast(&pp->cv);
+  pthread_mutex_unlock(&pp->mtx);
+}
+
+static int decompress_ordered(int fd_in, int fd_out, const warpc_header* hdr,
+                              const codec_vtable* vt, const warpc_opts* o) {
+  const int stream = (hdr->orig_size == WARPC_SIZE_STREAM);
+  size_t chunk = (size_t)hdr->chunk_size_k * 1024;
+  size_t bound = 0;
+  if (vt->compress_bound(chunk, &bound) != 0 || bound == 0) bound = chunk + (chunk / 16) + 64;
+
+  size_t depth = (size_t)o->threads * 2;
+  dpipe pp = { vt, fd_in, fd_out, NULL, NULL, NULL, 0, 0, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER };
+  pp.inpool  = pool_create(depth, bound);
+  pp.outpool = pool_create(depth, chunk);
+  sjob* jobs = (sjob*)calloc(depth, sizeof(*jobs));
+  struct threadpool* tp = (pp.inpool && pp.outpool && jobs) ? tp_create((size_t)o->threads) : NULL;
+  if (!tp) {
+    fprintf(stderr, "OOM\n");
+    pool_destroy(pp.inpool); pool_destroy(pp.outpool); free(jobs);
+    return 1;
+  }
+
+  uint64_t done = 0, issued = 0, written = 0;
+  int rc = 0, eof = 0;
+
+  for (;;) {
+    while (!eof && issued - written < depth) {
+      if (!stream && done == hdr->orig_size) { eof = 1; break; }
+      uint64_t uc[2];
+      if (read_all(fd_in, uc, sizeof(uc)) != 0) { fprintf(stderr, "truncated container\n"); rc = 1; break; }
+      if (stream && uc[0] == 0 && uc[1] == 0) { eof = 1; break; }
+      if (uc[0] == 0 || uc[0] > chunk || uc[1] > bound || (!stream && uc[0] > hdr->orig_size - done)) {
+        fprintf(stderr, "corrupt chunk record\n"); rc = 1; break;
+      }
+      sjob* j = &jobs[issued % depth];
+      j->pp = &pp;
+      j->u = uc[0];
+      j->c = uc[1];
+      j->ok = 0;
+      j->done = 0;
+      j->ibuf = pool_acquire_wait(pp.inpool, -1);
+      j->obuf = pool_acquire_wait(pp.outpool, -1);
+      if (!j->ibuf || !j->obuf || read_all(fd_in, j->ibuf, (size_t)j->c) != 0) {
+        fprintf(stderr, "read chunk payload failed\n");
+        pool_release(pp.inpool, j->ibuf); pool_release(pp.outpool, j->obuf);
+        rc = 1; break;
+      }
+      if (tp_submit(tp, sjob_run, j) != 0) {
+        fprintf(stderr, "OOM\n");
+        pool_release(pp.inpool, j->ibuf); pool_release(pp.outpool, j->obuf);
+        rc = 1; break;
+      }
+      ++issued;
+      done += j->u;
+    }
+    if (rc || written == issued) break;
+
+    sjob* j = &jobs[written % depth];
+    pthread_mutex_lock(&pp.mtx);
+    while (!j->done) pthread_cond_wait(&pp.cv, &pp.mtx);
+    pthread_mutex_unlock(&pp.mtx);
+
+    if (!j->ok) { fprintf(stderr, "decompress failed (%s)\n", vt->name); rc = 1; break; }
+    if (write_all(fd_out, j->obuf, (size_t)j->u) != 0) { perror("write"); rc = 1; break; }
+    pool_release(pp.inpool, j->ibuf);
+    pool_release(pp.outpool, j->obuf);
+    ++written;
+  }
+
+  atomic_store(&pp.failed, rc);
+  tp_destroy(tp);
+  for (; written < issued; ++written) {
+    pool_release(pp.inpool, jobs[written % depth].ibuf);
+    pool_release(pp.outpool, jobs[written % depth].obuf);
+  }
+  if (!rc && o->verbose) fprintf(stderr, "decompressed %llu chunks -> %llu bytes\n",
+                                 (unsigned long long)issued, (unsigned long long)done);
+
+  free(jobs);
+  pool_destroy(pp.inpool);
+  pool_destroy(pp.outpool);
+  pthread_mutex_destroy(&pp.mtx);
+  pthread_cond_destroy(&pp.cv);
+  return rc;
+}
+
+/* ---------------- io_uring pipelines (--io uring) ---------------- */
+
+/*
+ * The main thread owns all I/O: reads for the next chunks and writes of
+ * finished chunks stay queued on the ring while workers only run codecs and
+ * post a NOP completion when done. Each slot keeps its pool buffers for the
+ * whole run, and those buffers are registered with the ring as fixed buffers.
+ * Both functions return -1 (before touching the output) when no ring can be
+ * created, so the caller falls back to the blocking pipeline.
+ *
+ * A worker whose NOP cannot be posted counts it in `lost` and writes a byte
+ * to the kick pipe; the reaper keeps a read of that pipe queued, so it wakes
+ * up, writes the missing completions off and fails the run.
+ */
+enum { UT_READ = 1, UT_CODEC = 2, UT_WHDR = 3, UT_WDATA = 4, UT_KICK = 5 };
+#define UTAG(kind, slot) (((uint64_t)(kind) << 32) | (uint64_t)(slot))
+
+typedef struct {
+  struct aio_ring*    ring;
+  const codec_vtable* vt;
+  const warpc_opts*   o;
+  size_t              bound;
+  int                 decode;
+  int                 kick[2];     /* pipe: workers write, the ring reads */
+  unsigned char       kick_buf[8];
+  atomic_int          lost;        /* codec completions that were never posted */
+} upipe;
+
+enum { US_FREE = 0, US_READING, US_CODEC, US_CODED, US_WRITING, US_RETIRED };
+
+typedef struct {
+  upipe*   up;
+  uint32_t slot;
+  void*    ibuf;
+  void*    obuf;
+  void*    vbuf;     /* compress --verify scratch, or NULL */
+  uint64_t in_off, out_off;
+  size_t   in_len;   /* bytes in ibuf */
+  size_t   want;     /* decode: expected output size */
+  size_t   out_len;  /* codec result; 0 = failed */
+  int      bad;      /* compress: round trip mismatch */
+  uint64_t rec[2];   /* compress: [u][c] record header */
+  int      state;
+  int      pending;  /* writes outstanding */
+} uslot;
+
+static void uslot_run(void* arg) {
+  uslot* s = (uslot*)arg;
+  upipe* up = s->up;
+  if (up->decode) s->out_len = (warpc_codec_decompress(up->vt, s->ibuf, s->in_len, s->obuf, s->want) == s->want) ? s->want : 0;
+  else {
+    s->out_len = chunk_compress(up->o, s->ibuf, s->in_len, s->obuf, up->bound);
+    s->bad = s->out_len && s->vbuf && chunk_roundtrip(up->o, s->ibuf, s->in_len, s->obuf, s->out_len, s->vbuf) != 0;
+  }
+  if (aio_post(up->ring, UTAG(UT_CODEC, s->slot)) != 0) {
+    atomic_fetch_add(&up->lost, 1);
+    if (write(up->kick[1], "", 1) != 1) perror("io_uring kick");
+  }
+}
+
+static int uring_kick_arm(upipe* up) {
+  return aio_read(up->ring, up->kick[0], up->kick_buf, sizeof(up->kick_buf), 0, UTAG(UT_KICK, 0));
+}
+
+/* Opens the kick pipe and queues its first read; -1 leaves nothing open. */
+static int uring_kick_open(upipe* up) {
+  if (pipe(up->kick) != 0) return -1;
+  if (uring_kick_arm(up) != 0 || aio_submit(up->ring) != 0) { close(up->kick[0]); close(up->kick[1]); return -1; }
   return 0;
 }
 
+/* Handles a UT_KICK completion: drops the lost codec completions from *ops
+ * and re-arms the read. Returns nonzero when the run must fail. */
+static int uring_kicked(upipe* up, size_t* ops) {
+  size_t n = (size_t)atomic_exchange(&up->lost, 0);
+  if (n) fprintf(stderr, "io_uring: %zu codec completion(s) could not be posted\n", n);
+  *ops -= n;
+  return (uring_kick_arm(up) != 0 || aio_submit(up->ring) != 0) || n != 0;
+}
+
+/* Completes a short transfer synchronously; returns 0 when all n bytes moved. */
+static int uring_finish(int res, int write, int fd, void* buf, size_t n, uint64_t off) {
+  if (res < 0) return -1;
+  size_t done = (size_t)res;
+  if (done >= n) return 0;
+  return write ? pwrite_all(fd, (char*)buf + done, n - done, (off_t)(off + done))
+               : pread_all (fd, (char*)buf + done, n - done, (off_t)(off + done));
+}
+
+static struct aio_ring* uring_setup(uslot* slots, size_t depth, size_t ilen, size_t olen) {
+  unsigned entries = 8;
+  while (entries < depth * 4) entries <<= 1;
+  struct aio_ring* ring = aio_create(entries);
+  if (!ring) return NULL;
+  void** bufs = (void**)calloc(depth * 2, sizeof(*bufs));
+  size_t* lens = (size_t*)calloc(depth * 2, sizeof(*lens));
+  if (bufs && lens) {
+    for (size_t i = 0; i < depth; ++i) {
+      bufs[2*i] = slots[i].ibuf; lens[2*i] = ilen;
+      bufs[2*i+1] = slots[i].obuf; lens[2*i+1] = olen;
+    }
+    (void)aio_register_buffers(ring, bufs, lens, depth * 2); /* plain ops if this fails */
+  }
+  free(bufs); free(lens);
+  return ring;
+}
+
+/* Slots with buffers from two pools; NULL on OOM. */
+static uslot* uslots_create(size_t depth, struct bufpool* inpool, struct bufpool* outpool, upipe* up) {
+  uslot* slots = (uslot*)calloc(depth, sizeof(*slots));
+  if (!slots) return NULL;
+  for (size_t i = 0; i < depth; ++i) {
+    slots[i].up = up;
+    slots[i].slot = (uint32_t)i;
+    slots[i].ibuf = pool_acquire(inpool);
+    slots[i].obuf = pool_acquire(outpool);
+    if (!slots[i].ibuf || !slots[i].obuf) { free(slots); return NULL; }
+  }
+  return slots;
+}
+
+static int compress_uring(int fd_in, int fd_out, uint64_t fsize, size_t chunk, size_t bound, const warpc_opts* o) {
+  size_t depth = (size_t)o->threads * 2;
+  upipe up = { NULL, o->vt, o, bound, 0, { -1, -1 }, { 0 }, 0 };
+  struct bufpool* inpool  = pool_create(depth, chunk);
+  struct bufpool* outpool = pool_create(depth, bound);
+  struct bufpool* vpool   = o->verify ? pool_create(depth, chunk) : NULL;
+  uslot* slots = (inpool && outpool && (vpool || !o->verify)) ? uslots_create(depth, inpool, outpool, &up) : NULL;
+  for (size_t i = 0; slots && vpool && i < depth; ++i) slots[i].vbuf = pool_acquire(vpool);
+  up.ring = slots ? uring_setup(slots, depth, chunk, bound) : NULL;
+  int kicked = up.ring && uring_kick_open(&up) == 0;
+  struct threadpool* tp = kicked ? tp_create((size_t)o->threads) : NULL;
+  if (!tp) {
+    aio_destroy(up.ring); free(slots); pool_destroy(inpool); pool_destroy(outpool); pool_destroy(vpool);
+    if (kicked) { close(up.kick[0]); close(up.kick[1]); }
+    return -1;
+  }
+
+  uint64_t nchunks = (fsize + chunk - 1) / chunk;
+  uint64_t issued = 0, placed = 0, retired = 0;
+  uint64_t out_pos = sizeof(warpc_header);
+  size_t ops = 0; /* completions still expected */
+  int rc = 0;
+
+  for (;;) {
+    if (!rc) {
+      while (issued < nchunks && issued - retired < depth) {
+        uslot* s = &slots[issued % depth];
+        s->in_off = issued * (uint64_t)chunk;
+        s->in_len = (fsize - s->in_off > chunk) ? chunk : (size_t)(fsize - s->in_off);
+        s->state = US_READING;
+        if (aio_read(up.ring, fd_in, s->ibuf, s->in_len, s->in_off, UTAG(UT_READ, s->slot)) != 0) { rc = 1; break; }
+        ++ops; ++issued;
+      }
+      /* records are placed strictly in order; their writes may complete in any order */
+      while (!rc && placed < issued && slots[placed % depth].state == US_CODED) {
+        uslot* s = &slots[placed % depth];
+        s->rec[0] = (uint64_t)s->in_len;
+        s->rec[1] = (uint64_t)s->out_len;
+        s->out_off = out_pos;
+        s->state = US_WRITING;
+        s->pending = 2;
+        if (aio_write(up.ring, fd_out, s->rec, sizeof(s->rec), out_pos, UTAG(UT_WHDR, s->slot)) != 0 ||
+            aio_write(up.ring, fd_out, s->obuf, s->out_len, out_pos + sizeof(s->rec), UTAG(UT_WDATA, s->slot)) != 0) {
+          rc = 1; break;
+        }
+        ops += 2;
+        out_pos += sizeof(s->rec) + s->out_len;
+        ++placed;
+        if (o->verbose) fprintf(stderr, "compressed %zu -> %zu bytes (%s)\n", s->in_len, s->out_len, o->vt->name);
+      }
+      if (aio_submit(up.ring) != 0) rc = 1;
+    }
+    if (ops == 0 && (rc || retired == nchunks)) break;
+
+    uint64_t tag; int res;
+    if (aio_wait(up.ring, &tag, &res) != 0) { perror("io_uring wait"); rc = 1; break; }
+    if ((tag >> 32) == UT_KICK) { if (uring_kicked(&up, &ops)) rc = 1; continue; }
+    --ops;
+    uslot* s = &slots[(uint32_t)tag];
+    switch ((int)(tag >> 32)) {
+      case UT_READ:
+        if (uring_finish(res, 0, fd_in, s->ibuf, s->in_len, s->in_off) != 0) { fprintf(stderr, "read failed\n"); rc = 1; }
+        if (rc) break;
+        s->state = US_CODEC;
+        if (tp_submit(tp, uslot_run, s) != 0) { rc = 1; break; }
+        ++ops;
+        break;
+      case UT_CODEC:
+        if (s->out_len == 0) {
+          fprintf(stderr, "Compression failed (codec=%s, level=%d).\n", o->vt->name, o->level); rc = 1;
+        } else if (s->bad) {
+          fprintf(stderr, "verify: chunk %llu does not round-trip (codec=%s)\n", (unsigned long long)(s->in_off / chunk), o->vt->name); rc = 1;
+        }
+        s->state = US_CODED;
+        break;
+      default: /* UT_WHDR / UT_WDATA */
+        if ((tag >> 32) == UT_WHDR
+              ? uring_finish(res, 1, fd_out, s->rec, sizeof(s->rec), s->out_off)
+              : uring_finish(res, 1, fd_out, s->obuf, s->out_len, s->out_off + sizeof(s->rec))) {
+          perror("write chunk"); rc = 1;
+        }
+        if (--s->pending == 0) s->state = US_RETIRED;
+        break;
+    }
+    while (retired < issued && slots[retired % depth].state == US_RETIRED) {
+      slots[retired % depth].state = US_FREE;
+      ++retired;
+    }
+  }
+
+  tp_destroy(tp);
+  aio_destroy(up.ring);
+  close(up.kick[0]); close(up.kick[1]);
+  for (size_t i = 0; i < depth; ++i) { pool_release(inpool, slots[i].ibuf); pool_release(outpool, slots[i].obuf); }
+  free(slots);
+  pool_destroy(inpool);
+  pool_destroy(outpool);
+  pool_destroy(vpool);
+  if (!rc && o->verify && o->verbose) fprintf(stderr, "verify: %llu chunks round-tripped\n", (unsigned long long)nchunks);
+  return rc;
+}
+
+static int decompress_uring(int fd_in, int fd_out, uint64_t fsize, const warpc_header* hdr,
+                            const codec_vtable* vt, const warpc_opts* o) {
+  drec* recs = NULL;
+  size_t nrec = 0;
+  uint64_t max_u = 0, max_c = 0;
+  if (scan_records(fd_in, hdr->orig_size, fsize, &recs, &nrec, &max_u, &max_c) != 0) {
+    fprintf(stderr, "truncated or corrupt container\n"); return 1;
+  }
+
+  size_t depth = (size_t)o->threads * 2;
+  upipe up = { NULL, vt, o, 0, 1, { -1, -1 }, { 0 }, 0 };
+  struct bufpool* inpool  = pool_create(depth, max_c ? (size_t)max_c : 1);
+  struct bufpool* outpool = pool_create(depth, max_u ? (size_t)max_u : 1);
+  uslot* slots = (inpool && outpool) ? uslots_create(depth, inpool, outpool, &up) : NULL;
+  up.ring = slots ? uring_setup(slots, depth, max_c ? (size_t)max_c : 1, max_u ? (size_t)max_u : 1) : NULL;
+  int kicked = up.ring && uring_kick_open(&up) == 0;
+  struct threadpool* tp = kicked ? tp_create((size_t)o->threads) : NULL;
+  uint32_t* freelist = (uint32_t*)calloc(depth, sizeof(*freelist));
+  if (!tp || !freelist) {
+    tp_destroy(tp); aio_destroy(up.ring); free(slots); free(freelist); free(recs);
+    pool_destroy(inpool); pool_destroy(outpool);
+    if (kicked) { close(up.kick[0]); close(up.kick[1]); }
+    return -1;
+  }
+  size_t nfree = depth;
+  for (size_t i = 0; i < depth; ++i) freelist[i] = (uint32_t)(depth - 1 - i);
+
+  /* no output ordering needed: every chunk has a known destination */
+  size_t next = 0, ops = 0;
+  int rc = 0;
+  for (;;) {
+    if (!rc) {
+      while (next < nrec && nfree > 0) {
+        uslot* s = &slots[freelist[--nfree]];
+        s->in_off  = (uint64_t)recs[next].in_off;
+        s->out_off = (uint64_t)recs[next].out_off;
+        s->in_len  = (size_t)recs[next].c;
+        s->want    = (size_t)recs[next].u;
+        s->state   = US_READING;
+        if (aio_read(up.ring, fd_in, s->ibuf, s->in_len, s->in_off, UTAG(UT_READ, s->slot)) != 0) { rc = 1; break; }
+        ++ops; ++next;
+      }
+      if (aio_submit(up.ring) != 0) rc = 1;
+    }
+    if (ops == 0 && (rc || next == nrec)) break;
+
+    uint64_t tag; int res;
+    if (aio_wait(up.ring, &tag, &res) != 0) { perror("io_uring wait"); rc = 1; break; }
+    if ((tag >> 32) == UT_KICK) { if (uring_kicked(&up, &ops)) rc = 1; continue; }
+    --ops;
+    uslot* s = &slots[(uint32_t)tag];
+    switch ((int)(tag >> 32)) {
+      case UT_READ:
+        if (uring_finish(res, 0, fd_in, s->ibuf, s->in_len, s->in_off) != 0) { fprintf(stderr, "read chunk payload failed\n"); rc = 1; }
+        if (rc) { freelist[nfree++] = s->slot; break; }
+        s->state = US_CODEC;
+        if (tp_submit(tp, uslot_run, s) != 0) { rc = 1; freelist[nfree++] = s->slot; break; }
+        ++ops;
+        break;
+      case UT_CODEC:
+        if (s->out_len == 0) { fprintf(stderr, "decompress failed (%s)\n", vt->name); rc = 1; }
+        if (rc) { freelist[nfree++] = s->slot; break; }
+        s->state = US_WRITING;
+        if (aio_write(up.ring, fd_out, s->obuf, s->want, s->out_off, UTAG(UT_WDATA, s->slot)) != 0) { rc = 1; freelist[nfree++] = s->slot; break; }
+        ++ops;
+        break;
+      default:
+        if (uring_finish(res, 1, fd_out, s->obuf, s->want, s->out_off) != 0) { perror("write"); rc = 1; }
+        s->state = US_FREE;
+        freelist[nfree++] = s->slot;
+        break;
+    }
+  }
+  if (!rc && o->verbose) fprintf(stderr, "decompressed %zu chunks (io_uring)\n", nrec);
+
+  tp_destroy(tp);
+  aio_destroy(up.ring);
+  close(up.kick[0]); close(up.kick[1]);
+  for (size_t i = 0; i < depth; ++i) { pool_release(inpool, slots[i].ibuf); pool_release(outpool, slots[i].obuf); }
+  free(slots); free(freelist); free(recs);
+  pool_destroy(inpool);
+  pool_destroy(outpool);
+  return rc;
+}
+
 static int do_decompress(const char* in, const char* out, const warpc_opts* o) {
-  (void)o;
-  int fd_in = file_open_rd(in); if (fd_in < 0) { perror("open input"); return 1; }
-  int fd_out = file_open_trunc(out); if (fd_out < 0) { perror("open output"); close(fd_in); return 1; }
+  const int indexed = !is_stdio(in) && !is_stdio(out);
+  uint64_t fsize = 0;
+  if (indexed && file_stat_size(in, &fsize) != 0) { perror("stat"); return 1; }
+  int fd_in = open_in(in); if (fd_in < 0) { perror("open input"); return 1; }
 
   warpc_header hdr;
-  if (read_all(fd_in, &hdr, sizeof(hdr)) != 0) { fprintf(stderr, "read header failed\n"); close(fd_in); close(fd_out); return 1; }
-  if (hdr.magic != WARPC_MAGIC || hdr.version != WARPC_VERSION) { fprintf(stderr, "bad container\n"); close(fd_in); close(fd_out); return 1; }
+  if (read_all(fd_in, &hdr, sizeof(hdr)) != 0) { fprintf(stderr, "read header failed\n"); close(fd_in); return 1; }
+  if (hdr.magic != WARPC_MAGIC || hdr.version != WARPC_VERSION) { fprintf(stderr, "bad container\n"); close(fd_in); return 1; }
 
   const codec_vtable* vt = warpc_get_codec_by_id((int)hdr.codec);
-  if (!vt) { fprintf(stderr, "codec %u not available\n", (unsigned)hdr.codec); close(fd_in); close(fd_out); return 1; }
+  if (!vt) { fprintf(stderr, "codec %u not available\n", (unsigned)hdr.codec); close(fd_in); return 1; }
 
-  size_t chunk = (size_t)hdr.chunk_size_k * 1024;
-  void* ibuf = malloc(chunk * 2);
-  void* obuf = malloc(chunk);
-  if (!ibuf || !obuf) { fprintf(stderr, "OOM\n"); close(fd_in); close(fd_out); free(ibuf); free(obuf); return 1; }
+  int fd_out = open_out(out); if (fd_out < 0) { perror("open output"); close(fd_in); return 1; }
 
-  uint64_t done = 0;
-  while (done < hdr.orig_size) {
-    uint64_t u = 0, c = 0;
-    if (read_all(fd_in, &u, sizeof(u)) != 0) break;
-    if (read_all(fd_in, &c, sizeof(c)) != 0) break;
-    if (c > (uint64_t)(chunk*2)) { ibuf = realloc(ibuf, (size_t)c); if (!ibuf) { fprintf(stderr, "OOM\n"); break; } }
-    if (u > (uint64_t)chunk)     { obuf = realloc(obuf, (size_t)u); if (!obuf) { fprintf(stderr, "OOM\n"); break; } }
-    if (read_all(fd_in, ibuf, (size_t)c) != 0) { fprintf(stderr, "read chunk payload failed\n"); break; }
+  int rc = -1;
+  if (indexed && o->io == IO_URING) {
+    rc = decompress_uring(fd_in, fd_out, fsize, &hdr, vt, o);
+    if (rc < 0 && o->verbose) fprintf(stderr, "io_uring unavailable, using blocking I/O\n");
+  }
+  if (rc < 0) rc = indexed ? decompress_indexed(fd_in, fd_out, fsize, &hdr, vt, o)
+                           : decompress_ordered(fd_in, fd_out, &hdr, vt, o);
+  close(fd_in); close(fd_out);
+  return rc;
+}
 
-    size_t got = vt->decompress(ibuf, (size_t)c, obuf, (size_t)u);
-    if (got != (size_t)u) { fprintf(stderr, "decompress failed (%s)\n", vt->name); break; }
-    if (write_all(fd_out, obuf, (size_t)u) != 0) { perror("write"); break; }
+/* ---------------- Random-access cat ---------------- */
 
-    done += u;
+static int do_cat(const char* in, const warpc_opts* o) {
+  warp_reader_t* h = warp_open(in, o->cache_mib * 1024 * 1024);
+  if (!h) { fprintf(stderr, "cannot open %s as a WARP v3 container\n", in); return 1; }
+
+  uint64_t total = warp_reader_size(h);
+  uint64_t end = total; /* offset + length could wrap, so compare against what is left */
+  if (o->length && o->offset < total && o->length < total - o->offset) end = o->offset + o->length;
+  const size_t piece = 1u << 20;
+  void* buf = malloc(piece);
+  if (!buf) { warp_close(h); return 1; }
+
+  int rc = 0;
+  for (uint64_t pos = o->offset; pos < end; ) {
+    size_t want = (end - pos > piece) ? piece : (size_t)(end - pos);
+    int64_t got = warp_read_range(h, pos, want, buf);
+    if (got <= 0) { fprintf(stderr, "read failed at offset %llu\n", (unsigned long long)pos); rc = 1; break; }
+    if (write_all(STDOUT_FILENO, buf, (size_t)got) != 0) { perror("write"); rc = 1; break; }
+    pos += (uint64_t)got;
   }
 
-  free(ibuf); free(obuf);
-  close(fd_in); close(fd_out);
-  return (done == hdr.orig_size) ? 0 : 1;
+  free(buf);
+  warp_close(h);
+  return rc;
+}
+
+/* ---------------- WARP v3 archives and appends ---------------- */
+
+/* The CLI's codec/chunk/thread choices as WARP v3 options; `writes` is set
+ * for the commands that write chunks (archive, append, compact). */
+static void v3_opts(const warpc_opts* o, int writes, warp_opts_t* w) {
+  memset(w, 0, sizeof(*w));
+  w->algo        = o->v3_auto ? 0 : o->codec_id == CODEC_LZ4 ? WARP_ALGO_LZ4 : WARP_ALGO_ZSTD;
+  w->level       = o->level > 0 ? o->level : 1;
+  w->threads     = o->threads;
+  w->chunk_bytes = o->chunk_auto ? 0 : (int)(o->chunk_kib * 1024);
+  w->do_index    = 1;
+#ifdef HAVE_XXHASH
+  w->chk_kind    = WARP_CHK_XXH3; /* extraction and reads check every chunk */
+  (void)writes;
+#else
+  w->chk_kind    = WARP_CHK_NONE;
+  if (writes) fprintf(stderr, "warning: built without xxHash, chunks are not checksummed\n");
+#endif
+  w->cdc         = o->cdc;
+  w->prefix_group = o->prefix_group;
+  w->dict        = o->dict;
+  w->verbose     = o->verbose;
+  w->no_mmap     = o->io == IO_PREAD;
+}
+
+/* ---------------- I/O backend benchmark ---------------- */
+
+static double now_secs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* Times compress + decompress of <in> with each I/O backend; scratch files sit next to <in>. */
+static int do_bench(const char* in, const warpc_opts* o) {
+  static const struct { int io; const char* name; } backends[] = {
+    { IO_PREAD, "pread" }, { IO_MMAP, "mmap" }, { IO_URING, "uring" },
+  };
+  uint64_t fsize = 0;
+  if (file_stat_size(in, &fsize) != 0) { perror("stat"); return 1; }
+  char* cpath = (char*)malloc(strlen(in) + 16);
+  char* dpath = (char*)malloc(strlen(in) + 16);
+  if (!cpath || !dpath) { free(cpath); free(dpath); return 1; }
+  sprintf(cpath, "%s.bench.warp", in);
+  sprintf(dpath, "%s.bench.out", in);
+
+  const double mb = (double)fsize / 1e6;
+  fprintf(stderr, "%s: %.1f MB, codec=%s level=%d chunk=%zu KiB threads=%d\n",
+          in, mb, o->vt ? o->vt->name : "-", o->level, o->chunk_kib, o->threads);
+  int rc = 0;
+  for (size_t b = 0; b < sizeof(backends) / sizeof(backends[0]) && !rc; ++b) {
+    warpc_opts v = *o; v.io = backends[b].io; v.verify = 0; v.verbose = 0;
+    double t0 = now_secs();
+    if (do_compress(in, cpath, &v) != 0) { rc = 1; break; }
+    double t1 = now_secs();
+    if (do_decompress(cpath, dpath, &v) != 0) { rc = 1; break; }
+    double t2 = now_secs();
+    if (whash64_file(in, 1<<20) != whash64_file(dpath, 1<<20)) { fprintf(stderr, "%s: round-trip mismatch\n", backends[b].name); rc = 1; }
+    printf("%-6s compress %8.1f MB/s   decompress %8.1f MB/s\n",
+           backends[b].name, mb / (t1 - t0 > 1e-9 ? t1 - t0 : 1e-9), mb / (t2 - t1 > 1e-9 ? t2 - t1 : 1e-9));
+  }
+  unlink(cpath); unlink(dpath);
+  free(cpath); free(dpath);
+  return rc;
 }
 
 /* ---------------- main ---------------- */
@@ -233,6 +1168,24 @@ int main(int argc, char** argv) {
 
   if (mode == 1) { /* compress */
     return do_compress(in, out, &opt);
+  } else if (mode == 3) { /* cat */
+    return do_cat(in, &opt);
+  } else if (mode == 4) { /* bench */
+    return do_bench(in, &opt);
+  } else if (mode == 5) { /* calibrate */
+    return warp_calibrate(out, opt.verbose);
+  } else if (mode == 6) { /* train */
+    return warp_train_dict(out, opt.samples, opt.nsamples, opt.dict_kib * 1024, opt.level, opt.verbose);
+  } else if (mode >= 7 && mode <= 9) { /* archive / extract / list */
+    warp_opts_t w;
+    v3_opts(&opt, mode == 7, &w);
+    if (mode == 7) return warp_archive_create(in, out, &w);
+    if (mode == 8) return warp_archive_extract(in, out, opt.members, opt.nmembers, &w);
+    return warp_archive_list(in, stdout);
+  } else if (mode == 10 || mode == 11) { /* append / compact */
+    warp_opts_t w;
+    v3_opts(&opt, 1, &w);
+    return mode == 10 ? warp_append_file(in, out, &w) : warp_compact(in, &w);
   } else { /* decompress */
     return do_decompress(in, out, &opt);
   }
@@ -0,0 +1,241 @@
+#define _XOPEN_SOURCE 700
+#include "warpc/profile.h"
+#include "warpc/warp.h"
+#include "warpc/simd.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#define PROFILE_MAGIC  "warpc-profile"
+#define PROFILE_VER    1
+#define PROF_SAMPLE    (4u << 20)  /* bytes per synthetic class */
+#define PROF_MIN_SECS  0.1         /* repeat each measurement at least this long */
+
+static const int zstd_levels[] = { 1, 3, 6, 9, 12, 19 };
+
+static double now_secs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static const char* algo_name(int algo) {
+  switch (algo) {
+    case WARP_ALGO_ZSTD:   return "zstd";
+    case WARP_ALGO_LZ4:    return "lz4";
+    case WARP_ALGO_SNAPPY: return "snappy";
+    default:               return NULL;
+  }
+}
+
+static int algo_from_name(const char* s) {
+  for (int a = WARP_ALGO_ZSTD; a <= WARP_ALGO_SNAPPY; a++) if (strcmp(s, algo_name(a)) == 0) return a;
+  return 0;
+}
+
+int profile_default_path(char* buf, size_t cap) {
+  const char* p = getenv("WARPC_PROFILE");
+  int n;
+  if (p && *p) n = snprintf(buf, cap, "%s", p);
+  else if ((p = getenv("XDG_CONFIG_HOME")) && *p) n = snprintf(buf, cap, "%s/warpc/profile", p);
+  else if ((p = getenv("HOME")) && *p) n = snprintf(buf, cap, "%s/.config/warpc/profile", p);
+  else return -1;
+  return (n < 0 || (size_t)n >= cap) ? -1 : 0;
+}
+
+int profile_load(const char* path, warp_profile_t* p) {
+  FILE* f = fopen(path, "r");
+  if (!f) return -1;
+  char line[256], magic[32];
+  int ver = 0;
+  p->n = 0;
+  if (!fgets(line, sizeof(line), f) || sscanf(line, "%31s %d", magic, &ver) != 2 ||
+      strcmp(magic, PROFILE_MAGIC) != 0 || ver != PROFILE_VER) { fclose(f); return -1; }
+  while (fgets(line, sizeof(line), f) && p->n < PROFILE_MAX) {
+    profile_ent_t e;
+    char codec[16];
+    if (line[0] == '#' || line[0] == '\n') continue;
+    if (sscanf(line, "%15s %lf %15s %d %lf %lf", e.cls, &e.bits, codec, &e.level, &e.ratio, &e.mbps) != 6) continue;
+    if (!(e.algo = algo_from_name(codec)) || e.ratio <= 0.0 || e.mbps <= 0.0) continue;
+    p->ent[p->n++] = e;
+  }
+  fclose(f);
+  return p->n > 0 ? 0 : -1;
+}
+
+/* mkdir -p of the directory part of path */
+static int make_parent(const char* path) {
+  char dir[4096];
+  if (snprintf(dir, sizeof(dir), "%s", path) >= (int)sizeof(dir)) return -1;
+  char* slash = strrchr(dir, '/');
+  if (!slash || slash == dir) return 0;
+  *slash = '\0';
+  for (char* s = dir + 1; *s; s++) {
+    if (*s != '/') continue;
+    *s = '\0';
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) return -1;
+    *s = '/';
+  }
+  return (mkdir(dir, 0755) != 0 && errno != EEXIST) ? -1 : 0;
+}
+
+int profile_save(const char* path, const warp_profile_t* p) {
+  char tmp[4096];
+  if (make_parent(path) != 0) return -1;
+  if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp)) return -1;
+  FILE* f = fopen(tmp, "w");
+  if (!f) return -1;
+  fprintf(f, "%s %d\n# class bits/byte codec level ratio MB/s\n", PROFILE_MAGIC, PROFILE_VER);
+  for (int i = 0; i < p->n; i++) {
+    const profile_ent_t* e = &p->ent[i];
+    fprintf(f, "%s %.3f %s %d %.4f %.1f\n", e->cls, e->bits, algo_name(e->algo), e->level, e->ratio, e->mbps);
+  }
+  int bad = ferror(f);
+  if (fclose(f) != 0 || bad || rename(tmp, path) != 0) { remove(tmp); return -1; }
+  return 0;
+}
+
+double profile_entropy(const uint32_t hist[256], double total) {
+  double bits = 0.0;
+  if (total <= 0.0) return 0.0;
+  for (int c = 0; c < 256; c++) if (hist[c]) { double q = hist[c] / total; bits -= q * log2(q); }
+  return bits;
+}
+
+const profile_ent_t* profile_lookup(const warp_profile_t* p, double bits, int algo, int level) {
+  const profile_ent_t* cls = NULL;
+  for (int i = 0; i < p->n; i++)
+    if (!cls || fabs(p->ent[i].bits - bits) < fabs(cls->bits - bits)) cls = &p->ent[i];
+  if (!cls) return NULL;
+  const profile_ent_t* best = NULL;
+  for (int i = 0; i < p->n; i++) {
+    const profile_ent_t* e = &p->ent[i];
+    if (e->algo != algo || strcmp(e->cls, cls->cls) != 0) continue;
+    if (!best || abs(e->level - level) < abs(best->level - level)) best = e;
+  }
+  return best;
+}
+
+/* ---------- synthetic data classes ---------- */
+
+static uint64_t rng_next(uint64_t* s) {
+  uint64_t x = *s;
+  x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+  return *s = x;
+}
+
+/* fixed-size records, mostly zero padding (logs of counters, sparse tables) */
+static void gen_sparse(unsigned char* p, size_t n, uint64_t* s) {
+  memset(p, 0, n);
+  for (size_t i = 0; i + 64 <= n; i += 64) {
+    uint64_t id = i / 64;
+    memcpy(p + i, &id, sizeof(id));
+    uint32_t v = (uint32_t)(rng_next(s) % 1000);
+    memcpy(p + i + 16, &v, sizeof(v));
+  }
+}
+
+/* words from a skewed vocabulary, with punctuation and line breaks */
+static void gen_text(unsigned char* p, size_t n, uint64_t* s) {
+  char vocab[1024][12];
+  for (int w = 0; w < 1024; w++) {
+    int len = 2 + (int)(rng_next(s) % 9);
+    for (int c = 0; c < len; c++) vocab[w][c] = (char)('a' + rng_next(s) % 26);
+    vocab[w][len] = '\0';
+  }
+  size_t i = 0;
+  unsigned words = 0;
+  while (i < n) {
+    uint64_t r = rng_next(s);
+    const char* w = vocab[((r & 1023) * ((r >> 10) & 1023)) >> 10]; /* favours low indices */
+    for (const char* c = w; *c && i < n; c++) p[i++] = (unsigned char)*c;
+    if (i < n) p[i++] = (++words % 12 == 0) ? '\n' : ((r >> 20) % 16 == 0 ? ',' : ' ');
+  }
+}
+
+/* packed structs: ids, small integers and doubles */
+static void gen_binary(unsigned char* p, size_t n, uint64_t* s) {
+  size_t i = 0;
+  uint32_t id = 0;
+  while (i + 24 <= n) {
+    uint64_t r = rng_next(s);
+    uint32_t small = (uint32_t)(r % 4096);
+    double d = (double)(r >> 40) / 1024.0;
+    memcpy(p + i, &id, 4); id += 1 + (uint32_t)(r >> 60);
+    memcpy(p + i + 4, &small, 4);
+    memcpy(p + i + 8, &d, 8);
+    memcpy(p + i + 16, &r, 8);
+    i += 24;
+  }
+  memset(p + i, 0, n - i);
+}
+
+/* mostly random bytes with occasional repeats (partly compressed media) */
+static void gen_noisy(unsigned char* p, size_t n, uint64_t* s) {
+  size_t i = 0;
+  while (i < n) {
+    uint64_t r = rng_next(s);
+    size_t len = 16 + (size_t)(r % 240);
+    if (len > n - i) len = n - i;
+    if (i > 4096 && (r >> 32) % 4 == 0) {
+      memmove(p + i, p + i - 1 - (size_t)((r >> 40) % 4096), len);
+    } else {
+      for (size_t k = 0; k < len; k++) p[i + k] = (unsigned char)(rng_next(s) >> 56);
+    }
+    i += len;
+  }
+}
+
+static const struct {
+  const char* name;
+  void (*gen)(unsigned char*, size_t, uint64_t*);
+} classes[] = {
+  { "sparse", gen_sparse }, { "text", gen_text }, { "binary", gen_binary }, { "noisy", gen_noisy },
+};
+
+int profile_calibrate(warp_profile_t* p, profile_codec_fn run, size_t (*cap)(size_t), int verbose) {
+  const size_t n = PROF_SAMPLE, ocap = cap(n);
+  unsigned char* in  = (unsigned char*)malloc(n);
+  unsigned char* out = (unsigned char*)malloc(ocap);
+  if (!in || !out) { free(in); free(out); return -1; }
+  uint64_t seed = 0x9e3779b97f4a7c15ULL;
+  p->n = 0;
+  for (size_t c = 0; c < sizeof(classes) / sizeof(classes[0]); c++) {
+    uint32_t hist[256];
+    classes[c].gen(in, n, &seed);
+    simd_histogram(in, n, hist);
+    const double bits = profile_entropy(hist, (double)n);
+    for (int a = WARP_ALGO_ZSTD; a <= WARP_ALGO_SNAPPY; a++) {
+      const int nlev = a == WARP_ALGO_ZSTD ? (int)(sizeof(zstd_levels) / sizeof(zstd_levels[0])) : 1;
+      for (int l = 0; l < nlev && p->n < PROFILE_MAX; l++) {
+        const int level = a == WARP_ALGO_ZSTD ? zstd_levels[l] : 0;
+        size_t got = 0;
+        unsigned reps = 0;
+        double t0 = now_secs(), dt;
+        do {
+          got = run(a, in, n, level, out, ocap);
+          reps++;
+          dt = now_secs() - t0;
+        } while (got && dt < PROF_MIN_SECS);
+        if (!got) break; /* codec not built in */
+        profile_ent_t* e = &p->ent[p->n++];
+        snprintf(e->cls, sizeof(e->cls), "%s", classes[c].name);
+        e->bits  = bits;
+        e->algo  = a;
+        e->level = level;
+        e->ratio = (double)got / (double)n;
+        e->mbps  = (double)n * reps / (1024.0 * 1024.0) / (dt > 1e-9 ? dt : 1e-9);
+        if (verbose)
+          fprintf(stderr, "%-7s %.2f bits  %-6s level %-2d  ratio %.3f  %8.1f MB/s\n",
+                  e->cls, bits, algo_name(a), level, e->ratio, e->mbps);
+      }
+    }
+  }
+  free(in);
+  free(out);
+  return p->n > 0 ? 0 : -1;
+}
@@ -0,0 +1,373 @@
+// src/reader.c
+#include "warp.h"
+#include "codecs.h"
+#include "util.h"
+#include "dict.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#ifdef HAVE_XXHASH
+#  include <xxhash.h>
+#endif
+
+/* zstd / lz4 through the codecs.h registry; 0 when not built in */
+static size_t reg_decompress(const char *name, void *dst, size_t cap, const void *src, size_t n) {
+  const codec_vtable *vt = warpc_get_codec_by_name(name);
+  return vt ? warpc_codec_decompress(vt, src, n, dst, cap) : 0;
+}
+
+/* ---------- decoded-chunk LRU ---------- */
+
+typedef struct rcache_ent {
+  uint32_t idx;
+  unsigned char *data;
+  size_t len;
+  struct rcache_ent *prev, *next;
+} rcache_ent;
+
+struct warp_reader {
+  int fd;
+  warp_chunk_t *table;
+  uint64_t *ustart;        /* n+1 prefix sums of orig_len */
+  uint32_t n;
+  uint32_t chunk_size;
+  uint64_t *sums;          /* WARP_CHK_XXH3 per chunk, or NULL */
+
+  warp_dict_t *dict;       /* WARP_FLAG_DICT files */
+  unsigned char *comp;     /* scratch for one compressed payload */
+  size_t comp_cap;
+
+  rcache_ent **slot;       /* per-chunk lookup, NULL if not cached */
+  rcache_ent *head, *tail; /* MRU .. LRU */
+  size_t cache_used, cache_cap;
+
+  pthread_mutex_t mtx;
+};
+
+static void lru_unlink(warp_reader_t *h, rcache_ent *e) {
+  if (e->prev) e->prev->next = e->next; else h->head = e->next;
+  if (e->next) e->next->prev = e->prev; else h->tail = e->prev;
+  e->prev = e->next = NULL;
+}
+
+static void lru_push_front(warp_reader_t *h, rcache_ent *e) {
+  e->prev = NULL;
+  e->next = h->head;
+  if (h->head) h->head->prev = e; else h->tail = e;
+  h->head = e;
+}
+
+static void lru_evict_until(warp_reader_t *h, size_t need) {
+  while (h->tail && h->cache_used + need > h->cache_cap) {
+    rcache_ent *e = h->tail;
+    lru_unlink(h, e);
+    h->slot[e->idx] = NULL;
+    h->cache_used -= e->len;
+    free(e->data);
+    free(e);
+  }
+}
+
+/* ---------- index loading ---------- */
+
+#define WARP_MAX_SEGMENTS 65536
+
+typedef struct { uint64_t wix_off, chk_off; } seg_ref_t;
+
+/* A segment's WARP_CHK_XXH3 sums into sums[0, count): 1 if read, 0 if the
+ * segment has none, -1 if they are damaged. */
+static int read_seg_sums(int fd, uint64_t chk_off, uint32_t count, uint64_t *sums) {
+  wchk_header_t ch;
+  uint32_t cnt;
+  if (!chk_off) return 0;
+  if (pread_all(fd, &ch, sizeof(ch), (off_t)chk_off) != 0 || ch.magic != WCHK_MAGIC) return -1;
+  if (ch.kind != WARP_CHK_XXH3) return 0;
+  if (ch.dlen != 8 || pread_all(fd, &cnt, sizeof(cnt), (off_t)(chk_off + sizeof(ch))) != 0 || cnt != count) return -1;
+  return pread_all(fd, sums, (size_t)count * sizeof(*sums), (off_t)(chk_off + sizeof(ch) + sizeof(cnt))) == 0 ? 1 : -1;
+}
+
+int warp_read_table(int fd, warp_chunk_t **table_out, uint32_t *count_out, uint64_t **sums_out) {
+  warp_header_t hdr;
+  off_t end = lseek(fd, 0, SEEK_END);
+  if (pread_all(fd, &hdr, sizeof(hdr), 0) != 0 || hdr.magic != WARP_MAGIC || hdr.version != WARP_VER) return -1;
+
+  /* newest footer first; appends chain back through wftr_ext_t.prev_ftr */
+  seg_ref_t *seg = NULL;
+  size_t nseg = 0, cap = 0;
+  uint64_t at = end >= (off_t)(sizeof(hdr) + sizeof(wftr_footer_t)) ? (uint64_t)end - sizeof(wftr_footer_t) : 0;
+  int rc = 0;
+  while (at && !rc) {
+    wftr_footer_t ft;
+    wftr_ext_t ext;
+    memset(&ext, 0, sizeof(ext));
+    if (pread_all(fd, &ft, sizeof(ft), (off_t)at) != 0 || ft.magic != WFTR_MAGIC) {
+      rc = nseg ? -1 : 0; break; /* no footer at all: header table only */
+    }
+    if ((ft.flags & WFTR_FLAG_EXT) && (at < sizeof(ext) || pread_all(fd, &ext, sizeof(ext), (off_t)(at - sizeof(ext))) != 0)) { rc = -1; break; }
+    if (nseg == cap) {
+      size_t ncap = cap ? cap * 2 : 4;
+      seg_ref_t *ns = ncap <= WARP_MAX_SEGMENTS ? (seg_ref_t*)realloc(seg, ncap * sizeof(*ns)) : NULL;
+      if (!ns) { rc = -1; break; }
+      seg = ns; cap = ncap;
+    }
+    seg[nseg].wix_off = ft.wix_off;
+    seg[nseg].chk_off = ft.chk_off;
+    nseg++;
+    if (ext.prev_ftr >= at) { rc = ext.prev_ftr ? -1 : 0; break; } /* must go backwards */
+    at = ext.prev_ftr;
+  }
+  if (!rc && !(hdr.flags & WARP_FLAG_APPEND) && nseg > 1) rc = -1;
+
+  /* oldest segment first; only it may rely on the table after the header */
+  uint64_t total = 0;
+  for (size_t k = 0; k < nseg && !rc; k++) {
+    wix_header_t wh;
+    if (seg[k].wix_off) {
+      if (pread_all(fd, &wh, sizeof(wh), (off_t)seg[k].wix_off) != 0 || wh.magic != WIX_MAGIC) rc = -1;
+      else total += wh.count;
+    } else if (k != nseg - 1 || (hdr.flags & WARP_FLAG_STREAM)) {
+      rc = -1;
+    } else {
+      total += hdr.chunk_count;
+    }
+  }
+  if (!nseg && !rc) {
+    if (hdr.flags & WARP_FLAG_STREAM) rc = -1; /* streamed layout without its trailer */
+    total = hdr.chunk_count;
+  }
+  if (rc || total > UINT32_MAX) { free(seg); return -1; }
+
+  warp_chunk_t *table = (warp_chunk_t*)calloc(total ? (size_t)total : 1, sizeof(*table));
+  uint64_t *sums = sums_out ? (uint64_t*)calloc(total ? (size_t)total : 1, sizeof(*sums)) : NULL;
+  wix_entry_v1_t *ents = NULL;
+  if (!table || (sums_out && !sums)) { free(table); free(sums); free(seg); return -1; }
+  uint32_t n = 0;
+  int have_sums = 0;
+  for (size_t k = nseg; k-- > 0 && !rc; ) {
+    wix_header_t wh;
+    const uint32_t first = n;
+    if (!seg[k].wix_off) {
+      if (pread_all(fd, table, (size_t)hdr.chunk_count * sizeof(*table), sizeof(hdr)) != 0) rc = -1;
+      n += hdr.chunk_count;
+    } else if (pread_all(fd, &wh, sizeof(wh), (off_t)seg[k].wix_off) != 0 || wh.count > total - n) {
+      rc = -1;
+    } else {
+      wix_entry_v1_t *ne = (wix_entry_v1_t*)realloc(ents, (wh.count ? wh.count : 1) * sizeof(*ents));
+      if (!ne) { rc = -1; break; }
+      ents = ne;
+      if (pread_all(fd, ents, wh.count * sizeof(*ents), (off_t)(seg[k].wix_off + sizeof(wh))) != 0) { rc = -1; break; }
+      for (uint32_t i = 0; i < wh.count; i++, n++) {
+      table[n].orig_len = ents[i].orig_len;
+      table[n].comp_len = ents[i].comp_len;
+      table[n].offset   = ents[i].payload_off;
+      table[n].algo     = ents[i].algo;
+      table[n].ref      = ents[i].ref;
+      }
+    }
+    if (!rc && sums) {
+      const int got = read_seg_sums(fd, seg[k].chk_off, n - first, sums + first);
+      if (got < 0) rc = -1;
+      have_sums |= got;
+    }
+  }
+  if (!nseg && !rc && pread_all(fd, table, (size_t)total * sizeof(*table), sizeof(hdr)) != 0) rc = -1;
+  free(ents);
+  free(seg);
+  if (rc) { free(table); free(sums); return -1; }
+  if (!have_sums) { free(sums); sums = NULL; }
+  *table_out = table;
+  *count_out = (uint32_t)total;
+  if (sums_out) *sums_out = sums;
+  return 0;
+}
+
+static int load_index(warp_reader_t *h) {
+  warp_header_t hdr;
+  if (pread_all(h->fd, &hdr, sizeof(hdr), 0) != 0) return -1;
+  if (hdr.magic != WARP_MAGIC || hdr.version != WARP_VER) return -1;
+  h->chunk_size = hdr.chunk_size;
+  if ((hdr.flags & WARP_FLAG_DICT) &&
+      !(h->dict = warp_dict_pread(h->fd, sizeof(hdr) + ((hdr.flags & WARP_FLAG_STREAM) ? 0 : (uint64_t)hdr.chunk_count * sizeof(warp_chunk_t)), 0)))
+    return -1;
+
+  uint64_t fsz = 0;
+  off_t end = lseek(h->fd, 0, SEEK_END);
+  if (end < (off_t)(sizeof(hdr) + sizeof(wftr_footer_t))) end = 0;
+  fsz = (uint64_t)end;
+
+#ifdef HAVE_XXHASH
+  if (warp_read_table(h->fd, &h->table, &h->n, &h->sums) != 0) return -1;
+#else
+  uint64_t *sums = NULL;
+  if (warp_read_table(h->fd, &h->table, &h->n, &sums) != 0) return -1;
+  if (sums) fprintf(stderr, "warning: built without xxHash, chunk checksums are not verified\n");
+  free(sums);
+#endif
+
+  h->ustart = (uint64_t*)malloc(((size_t)h->n + 1) * sizeof(*h->ustart));
+  if (!h->ustart) return -1;
+  h->ustart[0] = 0;
+  size_t max_comp = 0;
+  for (uint32_t i = 0; i < h->n; i++) {
+    warp_chunk_t *e = &h->table[i];
+    if (e->orig_len > h->chunk_size) return -1;
+    if (e->algo == WARP_ALGO_DUP) { /* decoded like the chunk it repeats */
+      if (e->ref == 0 || e->ref > i) return -1;
+      const warp_chunk_t *d = &h->table[i - e->ref];
+      if (d->algo == WARP_ALGO_ZSTD_REF || d->orig_len != e->orig_len) return -1;
+      e->algo = d->algo;
+    }
+    if (e->algo != WARP_ALGO_ZERO && e->offset + e->comp_len > fsz) return -1;
+    if (e->comp_len > max_comp) max_comp = e->comp_len;
+    h->ustart[i + 1] = h->ustart[i] + e->orig_len;
+  }
+
+  h->comp_cap = max_comp ? max_comp : 1;
+  h->comp = (unsigned char*)malloc(h->comp_cap);
+  h->slot = (rcache_ent**)calloc(h->n ? h->n : 1, sizeof(*h->slot));
+  return (h->comp && h->slot) ? 0 : -1;
+}
+
+/* ---------- chunk decode ---------- */
+
+static const unsigned char *chunk_get(warp_reader_t *h, uint32_t i);
+
+static int decode_payload(warp_reader_t *h, uint32_t i, unsigned char *dst) {
+  const warp_chunk_t *e = &h->table[i];
+  if (e->algo == WARP_ALGO_ZERO) { memset(dst, 0, e->orig_len); return 0; }
+  if (e->algo == WARP_ALGO_COPY) {
+    if (e->comp_len != e->orig_len) return -1;
+    return pread_all(h->fd, dst, e->orig_len, (off_t)e->offset);
+  }
+  /* prefix group: the first chunk comes from the cache (one extra decode on a
+   * miss) before h->comp is reused for this payload */
+  const unsigned char *prefix = NULL;
+  if (e->algo == WARP_ALGO_ZSTD_REF) {
+    if (e->ref == 0 || e->ref > i || h->table[i - e->ref].algo == WARP_ALGO_ZSTD_REF) return -1;
+    if (!(prefix = chunk_get(h, i - e->ref))) return -1;
+  }
+  if (pread_all(h->fd, h->comp, e->comp_len, (off_t)e->offset) != 0) return -1;
+
+  size_t got = 0;
+  switch (e->algo) {
+    case WARP_ALGO_ZSTD:   got = h->dict ? warp_dict_decompress(h->dict, dst, e->orig_len, h->comp, e->comp_len)
+                                     : reg_decompress("zstd", dst, e->orig_len, h->comp, e->comp_len); break;
+    case WARP_ALGO_LZ4:    got = reg_decompress("lz4", dst, e->orig_len, h->comp, e->comp_len); break;
+    case WARP_ALGO_SNAPPY: got = wc_snappy_decompress(dst, e->orig_len, h->comp, e->comp_len); break;
+    case WARP_ALGO_ZSTD_REF:
+      got = warp_prefix_decompress(dst, e->orig_len, h->comp, e->comp_len, prefix, h->table[i - e->ref].orig_len);
+      break;
+    default: got = 0; break;
+  }
+  return got == e->orig_len ? 0 : -1;
+}
+
+/* decode_payload plus the chunk's checksum, when the file has one */
+static int decode_chunk(warp_reader_t *h, uint32_t i, unsigned char *dst) {
+  if (decode_payload(h, i, dst) != 0) return -1;
+#ifdef HAVE_XXHASH
+  if (h->sums && h->sums[i] && XXH3_64bits(dst, h->table[i].orig_len) != h->sums[i]) return -1;
+#endif
+  return 0;
+}
+
+/* Returns the cached (decoding on miss) chunk, or NULL on error. */
+static const unsigned char *chunk_get(warp_reader_t *h, uint32_t i) {
+  rcache_ent *e = h->slot[i];
+  if (e) {
+    lru_unlink(h, e);
+    lru_push_front(h, e);
+    return e->data;
+  }
+
+  size_t len = h->table[i].orig_len;
+  lru_evict_until(h, len);
+  e = (rcache_ent*)calloc(1, sizeof(*e));
+  unsigned char *data = (unsigned char*)malloc(len ? len : 1);
+  if (!e || !data || decode_chunk(h, i, data) != 0) { free(e); free(data); return NULL; }
+  e->idx = i;
+  e->data = data;
+  e->len = len;
+  lru_push_front(h, e); /* may exceed a tiny cache until the next insert */
+  h->slot[i] = e;
+  h->cache_used += len;
+  return data;
+}
+
+/* ---------- public API ---------- */
+
+warp_reader_t *warp_open(const char *path, size_t cache_bytes) {
+  warp_reader_t *h = (warp_reader_t*)calloc(1, sizeof(*h));
+  if (!h) return NULL;
+  h->cache_cap = cache_bytes;
+  pthread_mutex_init(&h->mtx, NULL);
+  h->fd = open(path, O_RDONLY);
+  if (h->fd < 0 || load_index(h) != 0) { warp_close(h); return NULL; }
+  return h;
+}
+
+void warp_close(warp_reader_t *h) {
+  if (!h) return;
+  while (h->head) {
+    rcache_ent *e = h->head;
+    h->head = e->next;
+    free(e->data);
+    free(e);
+  }
+  if (h->fd >= 0) close(h->fd);
+  pthread_mutex_destroy(&h->mtx);
+  free(h->slot);
+  free(h->comp);
+  warp_dict_free(h->dict);
+  free(h->ustart);
+  free(h->table);
+  free(h->sums);
+  free(h);
+}
+
+uint64_t warp_reader_size(const warp_reader_t *h) {
+  return h->ustart ? h->ustart[h->n] : 0;
+}
+
+int64_t warp_read_range(warp_reader_t *h, uint64_t offset, size_t len, void *buf) {
+  const uint64_t total = warp_reader_size(h);
+  if (offset >= total || len == 0) return 0;
+  if (len > total - offset) len = (size_t)(total - offset);
+
+  pthread_mutex_lock(&h->mtx);
+
+  /* first chunk with ustart[i+1] > offset */
+  uint32_t lo = 0, hi = h->n;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    if (h->ustart[mid + 1] <= offset) lo = mid + 1; else hi = mid;
+  }
+
+  unsigned char *out = (unsigned char*)buf;
+  size_t done = 0;
+  for (uint32_t i = lo; done < len && i < h->n; i++) {
+    uint64_t cstart = h->ustart[i];
+    size_t   clen   = h->table[i].orig_len;
+    size_t   skip   = (size_t)(offset + done - cstart);
+    size_t   take   = clen - skip;
+    if (take > len - done) take = len - done;
+
+    if (skip == 0 && take == clen && !h->slot[i]) {
+      /* whole chunk requested and not cached: decode straight into buf */
+      if (decode_chunk(h, i, out + done) != 0) { pthread_mutex_unlock(&h->mtx); return -1; }
+    } else {
+      const unsigned char *data = chunk_get(h, i);
+      if (!data) { pthread_mutex_unlock(&h->mtx); return -1; }
+      memcpy(out + done, data + skip, take);
+    }
+    done += take;
+  }
+
+  pthread_mutex_unlock(&h->mtx);
+  return (int64_t)done;
+}
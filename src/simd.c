@@ -0,0 +1,275 @@
+#include "warpc/simd.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define WARPC_X86 1
+#  include <immintrin.h>
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+#  define WARPC_NEON 1
+#  include <arm_neon.h>
+#endif
+
+#define WH_PRIME 0x100000001b3ULL  /* FNV-64 prime = 2^40 + 0x1b3 */
+#define WH_BASIS 0xcbf29ce484222325ULL
+
+static uint64_t load64(const unsigned char* p) {
+  uint64_t v;
+  memcpy(&v, p, 8);
+  return v; /* native order: the hash is only compared within one machine */
+}
+
+/* ---------- scalar reference ---------- */
+
+static size_t run_length_scalar(const unsigned char* p, size_t n) {
+  if (n == 0) return 0;
+  const uint64_t pat = 0x0101010101010101ULL * p[0];
+  size_t i = 0;
+  while (i + 8 <= n && load64(p + i) == pat) i += 8;
+  while (i < n && p[i] == p[0]) i++;
+  return i;
+}
+
+static void hash_blocks_scalar(uint64_t lane[8], const unsigned char* p, size_t nblocks) {
+  for (size_t b = 0; b < nblocks; b++, p += 64) {
+    for (int k = 0; k < 8; k++) lane[k] = (lane[k] ^ load64(p + 8 * k)) * WH_PRIME;
+  }
+}
+
+/* Four interleaved tables hide the store-to-load dependency on repeated
+ * bytes; vector gathers/scatters do not beat this for a 256-bin histogram,
+ * so every variant shares it. */
+static void histogram_tables(const unsigned char* p, size_t n, uint32_t hist[256]) {
+  uint32_t t[4][256];
+  memset(t, 0, sizeof(t));
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) { t[0][p[i]]++; t[1][p[i+1]]++; t[2][p[i+2]]++; t[3][p[i+3]]++; }
+  for (; i < n; i++) t[0][p[i]]++;
+  for (int b = 0; b < 256; b++) hist[b] += t[0][b] + t[1][b] + t[2][b] + t[3][b];
+}
+
+static const simd_kernels_t k_scalar = { "scalar", run_length_scalar, hash_blocks_scalar, histogram_tables };
+
+/* ---------- x86 ---------- */
+
+#ifdef WARPC_X86
+/* x * WH_PRIME per 64-bit lane, from 32x32 multiplies:
+ * (x << 40) + lo(x)*0x1b3 + ((hi(x)*0x1b3) << 32) */
+__attribute__((target("sse2")))
+static inline __m128i mulp_sse2(__m128i x) {
+  const __m128i c = _mm_set1_epi64x(0x1b3);
+  __m128i lo = _mm_mul_epu32(x, c);
+  __m128i hi = _mm_slli_epi64(_mm_mul_epu32(_mm_srli_epi64(x, 32), c), 32);
+  return _mm_add_epi64(_mm_add_epi64(_mm_slli_epi64(x, 40), lo), hi);
+}
+
+__attribute__((target("sse2")))
+static size_t run_length_sse2(const unsigned char* p, size_t n) {
+  if (n == 0) return 0;
+  const __m128i v = _mm_set1_epi8((char)p[0]);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    unsigned m = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + i)), v));
+    if (m != 0xffffu) return i + (size_t)__builtin_ctz(~m);
+  }
+  while (i < n && p[i] == p[0]) i++;
+  return i;
+}
+
+__attribute__((target("sse2")))
+static void hash_blocks_sse2(uint64_t lane[8], const unsigned char* p, size_t nblocks) {
+  __m128i h[4];
+  for (int k = 0; k < 4; k++) h[k] = _mm_loadu_si128((const __m128i*)(lane + 2 * k));
+  for (size_t b = 0; b < nblocks; b++, p += 64) {
+    for (int k = 0; k < 4; k++) h[k] = mulp_sse2(_mm_xor_si128(h[k], _mm_loadu_si128((const __m128i*)(p + 16 * k))));
+  }
+  for (int k = 0; k < 4; k++) _mm_storeu_si128((__m128i*)(lane + 2 * k), h[k]);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i mulp_avx2(__m256i x) {
+  const __m256i c = _mm256_set1_epi64x(0x1b3);
+  __m256i lo = _mm256_mul_epu32(x, c);
+  __m256i hi = _mm256_slli_epi64(_mm256_mul_epu32(_mm256_srli_epi64(x, 32), c), 32);
+  return _mm256_add_epi64(_mm256_add_epi64(_mm256_slli_epi64(x, 40), lo), hi);
+}
+
+__attribute__((target("avx2")))
+static size_t run_length_avx2(const unsigned char* p, size_t n) {
+  if (n == 0) return 0;
+  const __m256i v = _mm256_set1_epi8((char)p[0]);
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    unsigned m = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(p + i)), v));
+    if (m != 0xffffffffu) return i + (size_t)__builtin_ctz(~m);
+  }
+  while (i < n && p[i] == p[0]) i++;
+  return i;
+}
+
+__attribute__((target("avx2")))
+static void hash_blocks_avx2(uint64_t lane[8], const unsigned char* p, size_t nblocks) {
+  __m256i h0 = _mm256_loadu_si256((const __m256i*)lane);
+  __m256i h1 = _mm256_loadu_si256((const __m256i*)(lane + 4));
+  for (size_t b = 0; b < nblocks; b++, p += 64) {
+    h0 = mulp_avx2(_mm256_xor_si256(h0, _mm256_loadu_si256((const __m256i*)p)));
+    h1 = mulp_avx2(_mm256_xor_si256(h1, _mm256_loadu_si256((const __m256i*)(p + 32))));
+  }
+  _mm256_storeu_si256((__m256i*)lane, h0);
+  _mm256_storeu_si256((__m256i*)(lane + 4), h1);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static size_t run_length_avx512(const unsigned char* p, size_t n) {
+  if (n == 0) return 0;
+  const __m512i v = _mm512_set1_epi8((char)p[0]);
+  size_t i = 0;
+  for (; i + 64 <= n; i += 64) {
+    uint64_t m = _mm512_cmpeq_epi8_mask(_mm512_loadu_si512((const void*)(p + i)), v);
+    if (m != ~0ULL) return i + (size_t)__builtin_ctzll(~m);
+  }
+  if (i < n) { /* masked tail: one compare, no byte loop */
+    __mmask64 live = (1ULL << (n - i)) - 1; /* n - i < 64 */
+    uint64_t m = _mm512_mask_cmpeq_epi8_mask(live, _mm512_maskz_loadu_epi8(live, p + i), v);
+    i += (m == live) ? n - i : (size_t)__builtin_ctzll(~m);
+  }
+  return i;
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void hash_blocks_avx512(uint64_t lane[8], const unsigned char* p, size_t nblocks) {
+  const __m512i c = _mm512_set1_epi64(0x1b3);
+  __m512i h = _mm512_loadu_si512((const void*)lane);
+  for (size_t b = 0; b < nblocks; b++, p += 64) {
+    __m512i x = _mm512_xor_si512(h, _mm512_loadu_si512((const void*)p));
+    __m512i lo = _mm512_mul_epu32(x, c);
+    __m512i hi = _mm512_slli_epi64(_mm512_mul_epu32(_mm512_srli_epi64(x, 32), c), 32);
+    h = _mm512_add_epi64(_mm512_add_epi64(_mm512_slli_epi64(x, 40), lo), hi);
+  }
+  _mm512_storeu_si512((void*)lane, h);
+}
+
+static const simd_kernels_t k_sse2   = { "sse2",   run_length_sse2,   hash_blocks_sse2,   histogram_tables };
+static const simd_kernels_t k_avx2   = { "avx2",   run_length_avx2,   hash_blocks_avx2,   histogram_tables };
+static const simd_kernels_t k_avx512 = { "avx512", run_length_avx512, hash_blocks_avx512, histogram_tables };
+#endif /* WARPC_X86 */
+
+/* ---------- ARM ---------- */
+
+#ifdef WARPC_NEON
+static size_t run_length_neon(const unsigned char* p, size_t n) {
+  if (n == 0) return 0;
+  const uint8x16_t v = vdupq_n_u8(p[0]);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    uint8x16_t eq = vceqq_u8(vld1q_u8(p + i), v);
+    uint64x2_t w = vreinterpretq_u64_u8(eq);
+    if ((vgetq_lane_u64(w, 0) & vgetq_lane_u64(w, 1)) != ~0ULL) break; /* locate below */
+  }
+  while (i < n && p[i] == p[0]) i++;
+  return i;
+}
+
+static inline uint64x2_t mulp_neon(uint64x2_t x) {
+  uint32x2_t lo32 = vmovn_u64(x);
+  uint32x2_t hi32 = vshrn_n_u64(x, 32);
+  uint64x2_t lo = vmull_n_u32(lo32, 0x1b3);
+  uint64x2_t hi = vshlq_n_u64(vmull_n_u32(hi32, 0x1b3), 32);
+  return vaddq_u64(vaddq_u64(vshlq_n_u64(x, 40), lo), hi);
+}
+
+static void hash_blocks_neon(uint64_t lane[8], const unsigned char* p, size_t nblocks) {
+  uint64x2_t h[4];
+  for (int k = 0; k < 4; k++) h[k] = vld1q_u64(lane + 2 * k);
+  for (size_t b = 0; b < nblocks; b++, p += 64) {
+    for (int k = 0; k < 4; k++) h[k] = mulp_neon(veorq_u64(h[k], vreinterpretq_u64_u8(vld1q_u8(p + 16 * k))));
+  }
+  for (int k = 0; k < 4; k++) vst1q_u64(lane + 2 * k, h[k]);
+}
+
+static const simd_kernels_t k_neon = { "neon", run_length_neon, hash_blocks_neon, histogram_tables };
+#endif /* WARPC_NEON */
+
+/* ---------- dispatch ---------- */
+
+const simd_kernels_t* simd_kernels_variant(const char* name) {
+  if (!name || strcmp(name, "scalar") == 0) return &k_scalar;
+#ifdef WARPC_X86
+  __builtin_cpu_init();
+  if (strcmp(name, "sse2") == 0)   return __builtin_cpu_supports("sse2") ? &k_sse2 : NULL;
+  if (strcmp(name, "avx2") == 0)   return __builtin_cpu_supports("avx2") ? &k_avx2 : NULL;
+  if (strcmp(name, "avx512") == 0)
+    return (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) ? &k_avx512 : NULL;
+#endif
+#ifdef WARPC_NEON
+  if (strcmp(name, "neon") == 0) return &k_neon;
+#endif
+  return NULL;
+}
+
+static const simd_kernels_t* g_kernels = &k_scalar;
+static pthread_once_t g_once = PTHREAD_ONCE_INIT;
+
+static void pick_kernels(void) {
+  const char* force = getenv("WARPC_SIMD");
+  const simd_kernels_t* k = force ? simd_kernels_variant(force) : NULL;
+  static const char* const order[] = { "avx512", "avx2", "sse2", "neon" };
+  for (size_t i = 0; !k && i < sizeof(order) / sizeof(order[0]); i++) k = simd_kernels_variant(order[i]);
+  g_kernels = k ? k : &k_scalar;
+}
+
+const simd_kernels_t* simd_kernels(void) {
+  pthread_once(&g_once, pick_kernels);
+  return g_kernels;
+}
+
+size_t simd_run_length(const void* p, size_t n) { return simd_kernels()->run_length((const unsigned char*)p, n); }
+
+int simd_is_zero(const void* p, size_t n) {
+  return n == 0 || (((const unsigned char*)p)[0] == 0 && simd_run_length(p, n) == n);
+}
+
+void simd_histogram(const void* p, size_t n, uint32_t hist[256]) {
+  memset(hist, 0, 256 * sizeof(*hist));
+  simd_kernels()->histogram((const unsigned char*)p, n, hist);
+}
+
+/* ---------- wide hash ---------- */
+
+void whash64_init(whash64_t* h) {
+  for (unsigned k = 0; k < 8; k++) h->lane[k] = WH_BASIS + k;
+  h->tlen = 0;
+  h->total = 0;
+}
+
+void whash64_update(whash64_t* h, const void* data, size_t n) {
+  const unsigned char* p = (const unsigned char*)data;
+  h->total += n;
+  if (h->tlen) {
+    size_t take = 64 - h->tlen < n ? 64 - h->tlen : n;
+    memcpy(h->tail + h->tlen, p, take);
+    h->tlen += take; p += take; n -= take;
+    if (h->tlen < 64) return;
+    simd_kernels()->hash_blocks(h->lane, h->tail, 1);
+    h->tlen = 0;
+  }
+  if (n >= 64) {
+    simd_kernels()->hash_blocks(h->lane, p, n / 64);
+    p += n & ~(size_t)63; n &= 63;
+  }
+  memcpy(h->tail, p, n);
+  h->tlen = n;
+}
+
+uint64_t whash64_final(const whash64_t* h) {
+  uint64_t x = WH_BASIS;
+  for (int k = 0; k < 8; k++) x = (x ^ h->lane[k]) * WH_PRIME;
+  for (size_t i = 0; i < h->tlen; i++) x = (x ^ h->tail[i]) * WH_PRIME;
+  x ^= h->total;
+  /* fmix64 avalanche */
+  x ^= x >> 33; x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33; x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return x;
+}
@@ -1,18 +1,75 @@
 #include "warpc/threadpool.h"
+#include <sched.h>
 #include <stdlib.h>
 
+/* Worker identity, so jobs submitted from inside a job stay local. */
+static _Thread_local struct threadpool* tls_pool;
+static _Thread_local size_t             tls_idx;
+
+static int dq_push(struct tp_deque* d, void (*fn)(void*), void* arg) {
+  pthread_mutex_lock(&d->mtx);
+  if (d->count == TP_DEQUE_CAP) { pthread_mutex_unlock(&d->mtx); return -1; }
+  struct job* j = &d->slots[(d->head + d->count) % TP_DEQUE_CAP];
+  j->fn = fn; j->arg = arg;
+  ++d->count;
+  pthread_mutex_unlock(&d->mtx);
+  return 0;
+}
+
+/* Owner and thieves both take the oldest job: the pipelines drain in
+ * submission order, so FIFO keeps the head of the window moving. */
+static int dq_pop(struct tp_deque* d, struct job* out) {
+  pthread_mutex_lock(&d->mtx);
+  if (d->count == 0) { pthread_mutex_unlock(&d->mtx); return -1; }
+  *out = d->slots[d->head];
+  d->head = (d->head + 1) % TP_DEQUE_CAP;
+  --d->count;
+  pthread_mutex_unlock(&d->mtx);
+  return 0;
+}
+
+static int take(struct threadpool* tp, size_t self, struct job* out) {
+  for (size_t k = 0; k < tp->nth; ++k) {
+    if (dq_pop(&tp->dq[(self + k) % tp->nth], out) == 0) {
+      atomic_fetch_sub(&tp->queued, 1);
+      return 0;
+    }
+  }
+  return -1;
+}
+
+static void finish(struct threadpool* tp) {
+  if (atomic_fetch_sub(&tp->active, 1) == 1) {
+    pthread_mutex_lock(&tp->mtx);
+    pthread_cond_broadcast(&tp->done_cv);
+    pthread_mutex_unlock(&tp->mtx);
+  }
+}
+
+typedef struct { struct threadpool* tp; size_t idx; } worker_arg;
+
 static void* worker(void* p) {
-  struct threadpool* tp = (struct threadpool*)p;
+  worker_arg wa = *(worker_arg*)p;
+  free(p);
+  struct threadpool* tp = wa.tp;
+  tls_pool = tp; tls_idx = wa.idx;
   for (;;) {
+    struct job j;
+    if (take(tp, wa.idx, &j) == 0) {
+      j.fn(j.arg);
+      finish(tp);
+      continue;
+    }
+    if (atomic_load(&tp->queued) > 0) { sched_yield(); continue; } /* another worker is mid-pop */
+
+    /* park: announce idle before re-checking so tp_submit cannot miss us */
     pthread_mutex_lock(&tp->mtx);
-    while (!tp->stop && tp->head == NULL) pthread_cond_wait(&tp->cv, &tp->mtx);
-    if (tp->stop && tp->head == NULL) { pthread_mutex_unlock(&tp->mtx); break; }
-    struct job* j = tp->head;
-    tp->head = j->next;
-    if (!tp->head) tp->tail = NULL;
+    atomic_fetch_add(&tp->idle, 1);
+    while (!tp->stop && atomic_load(&tp->queued) == 0) pthread_cond_wait(&tp->cv, &tp->mtx);
+    atomic_fetch_sub(&tp->idle, 1);
+    int quit = tp->stop && atomic_load(&tp->queued) == 0;
     pthread_mutex_unlock(&tp->mtx);
-    j->fn(j->arg);
-    free(j);
+    if (quit) break;
   }
   return NULL;
 }
@@ -21,14 +78,31 @@ struct threadpool* tp_create(size_t nthreads) {
   if (nthreads == 0) nthreads = 1;
   struct threadpool* tp = (struct threadpool*)calloc(1, sizeof(*tp));
   if (!tp) return NULL;
-  tp->nth = nthreads;
   tp->th = (pthread_t*)calloc(nthreads, sizeof(pthread_t));
-  if (!tp->th) { free(tp); return NULL; }
+  tp->dq = (struct tp_deque*)calloc(nthreads, sizeof(struct tp_deque));
+  if (!tp->th || !tp->dq) { free(tp->th); free(tp->dq); free(tp); return NULL; }
+  for (size_t i = 0; i < nthreads; ++i) pthread_mutex_init(&tp->dq[i].mtx, NULL);
   pthread_mutex_init(&tp->mtx, NULL);
   pthread_cond_init(&tp->cv, NULL);
+  pthread_cond_init(&tp->done_cv, NULL);
+  tp->nth = nthreads; /* deques exist for all slots, even if a thread fails to start */
+  size_t started = 0;
   for (size_t i = 0; i < nthreads; ++i) {
-    if (pthread_create(&tp->th[i], NULL, worker, tp) != 0) { /* best effort */ }
+    worker_arg* wa = (worker_arg*)malloc(sizeof(*wa));
+    if (!wa) continue;
+    wa->tp = tp; wa->idx = i;
+    if (pthread_create(&tp->th[started], NULL, worker, wa) != 0) { free(wa); continue; }
+    ++started;
   }
+  if (started == 0) {
+    for (size_t i = 0; i < nthreads; ++i) pthread_mutex_destroy(&tp->dq[i].mtx);
+    pthread_mutex_destroy(&tp->mtx);
+    pthread_cond_destroy(&tp->cv);
+    pthread_cond_destroy(&tp->done_cv);
+    free(tp->th); free(tp->dq); free(tp);
+    return NULL;
+  }
+  tp->nstarted = started;
   return tp;
 }
 
@@ -38,25 +112,41 @@ void tp_destroy(struct threadpool* tp) {
   tp->stop = 1;
   pthread_cond_broadcast(&tp->cv);
   pthread_mutex_unlock(&tp->mtx);
-  for (size_t i = 0; i < tp->nth; ++i) pthread_join(tp->th[i], NULL);
-  struct job* j = tp->head;
-  while (j) { struct job* n = j->next; free(j); j = n; }
+  for (size_t i = 0; i < tp->nstarted; ++i) pthread_join(tp->th[i], NULL);
+  for (size_t i = 0; i < tp->nth; ++i) pthread_mutex_destroy(&tp->dq[i].mtx);
   pthread_mutex_destroy(&tp->mtx);
   pthread_cond_destroy(&tp->cv);
+  pthread_cond_destroy(&tp->done_cv);
   free(tp->th);
+  free(tp->dq);
   free(tp);
 }
 
 int tp_submit(struct threadpool* tp, void (*fn)(void*), void* arg) {
-  struct job* j = (struct job*)malloc(sizeof(*j));
-  if (!j) return -1; /* OOM */
-  j->fn = fn; j->arg = arg; j->next = NULL;
-  pthread_mutex_lock(&tp->mtx);
-  if (tp->tail) tp->tail->next = j; else tp->head = j;
-  tp->tail = j;
-  pthread_cond_signal(&tp->cv);
-  pthread_mutex_unlock(&tp->mtx);
+  size_t start = (tls_pool == tp) ? tls_idx : atomic_fetch_add(&tp->next, 1) % tp->nth;
+  atomic_fetch_add(&tp->active, 1);
+  atomic_fetch_add(&tp->queued, 1); /* before the push, so a fast pop never underflows */
+  size_t k = 0;
+  for (; k < tp->nth; ++k) {
+    if (dq_push(&tp->dq[(start + k) % tp->nth], fn, arg) == 0) break;
+  }
+  if (k == tp->nth) { /* all rings full: caller runs it */
+    atomic_fetch_sub(&tp->queued, 1);
+    fn(arg);
+    finish(tp);
+    return 0;
+  }
+  if (atomic_load(&tp->idle) > 0) {
+    pthread_mutex_lock(&tp->mtx);
+    pthread_cond_signal(&tp->cv);
+    pthread_mutex_unlock(&tp->mtx);
+  }
   return 0;
 }
 
-
+void tp_barrier(struct threadpool* tp) {
+  if (!tp) return;
+  pthread_mutex_lock(&tp->mtx);
+  while (atomic_load(&tp->active) > 0) pthread_cond_wait(&tp->done_cv, &tp->mtx);
+  pthread_mutex_unlock(&tp->mtx);
+}
@@ -1,8 +1,11 @@
 #define _XOPEN_SOURCE 700
 #include "warpc/util.h"
+#include "warpc/simd.h"
+#include "warpc/warp.h"
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/uio.h>
+#include <sys/mman.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <string.h>
@@ -19,6 +22,16 @@ int read_all(int fd, void* buf, size_t n) {
   }
   return 0;
 }
+ssize_t read_upto(int fd, void* buf, size_t n) {
+  size_t off = 0;
+  while (off < n) {
+    ssize_t r = read(fd, (char*)buf + off, n - off);
+    if (r == 0) break; /* EOF */
+    if (r < 0) { if (errno == EINTR) continue; return -1; }
+    off += (size_t)r;
+  }
+  return (ssize_t)off;
+}
 int write_all(int fd, const void* buf, size_t n) {
   size_t off = 0;
   while (off < n) {
@@ -47,6 +60,35 @@ int pwrite_all(int fd, const void* buf, size_t n, off_t off) {
   }
   return 0;
 }
+ssize_t wc_pread(int fd, void* buf, size_t n, uint64_t off) {
+  size_t done = 0;
+  while (done < n) {
+    ssize_t r = pread(fd, (char*)buf + done, n - done, (off_t)(off + done));
+    if (r == 0) break; /* EOF */
+    if (r < 0) { if (errno == EINTR) continue; return -1; }
+    done += (size_t)r;
+  }
+  return (ssize_t)done;
+}
+ssize_t wc_pwrite(int fd, const void* buf, size_t n, uint64_t off) {
+  return pwrite_all(fd, buf, n, (off_t)off) == 0 ? (ssize_t)n : -1;
+}
+void wc_advise_sequential(int fd) {
+  (void)posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+}
+int wc_ftruncate_file(FILE* f, uint64_t size) {
+  if (fflush(f) != 0) return -1;
+  return ftruncate(fileno(f), (off_t)size);
+}
+
+/* 1 MiB chunks up to 256 MiB of input, then larger (up to 8 MiB) so the
+ * table stays around 256 entries. */
+uint32_t warp_pick_chunk_size(size_t bytes) {
+  uint32_t c = 1u << 20;
+  while (c < (8u << 20) && bytes / c > 256) c <<= 1;
+  return c;
+}
+
 int file_stat_size(const char* path, uint64_t* out) {
   struct stat st;
   if (stat(path, &st) != 0) return -1;
@@ -56,29 +98,42 @@ int file_stat_size(const char* path, uint64_t* out) {
 int file_open_rd(const char* path)    { return open(path, O_RDONLY); }
 int file_open_wr(const char* path)    { return open(path, O_WRONLY); }
 int file_open_trunc(const char* path) { return open(path, O_CREAT|O_TRUNC|O_WRONLY, 0644); }
+int file_is_seekable(int fd) {
+  struct stat st;
+  return fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+}
 
-uint64_t fnv1a64_update(uint64_t h, const void* data, size_t n) {
-  const unsigned char* p = (const unsigned char*)data;
-  h = (h == 0) ? 0xcbf29ce484222325ULL : h;
-  for (size_t i = 0; i < n; ++i) {
-    h ^= (uint64_t)p[i];
-    h *= 0x100000001b3ULL;
-  }
-  return h;
+const void* file_map_rd(int fd, uint64_t size) {
+  if (size == 0 || size > (uint64_t)SIZE_MAX / 2) return NULL;
+  void* p = mmap(NULL, (size_t)size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (p == MAP_FAILED) return NULL;
+  (void)posix_madvise(p, (size_t)size, POSIX_MADV_SEQUENTIAL);
+  return p;
 }
-uint64_t fnv1a64_file(const char* path, size_t chunk) {
+void file_unmap(const void* p, uint64_t size) {
+  if (p) munmap((void*)p, (size_t)size);
+}
+void file_map_willneed(const void* base, uint64_t off, size_t len) {
+  long pg = sysconf(_SC_PAGESIZE);
+  uint64_t a = off & ~(uint64_t)(pg > 0 ? pg - 1 : 4095);
+  (void)posix_madvise((char*)base + a, len + (size_t)(off - a), POSIX_MADV_WILLNEED);
+}
+
+uint64_t whash64_file(const char* path, size_t chunk) {
   int fd = file_open_rd(path);
   if (fd < 0) return 0;
   void* buf = malloc(chunk);
   if (!buf) { close(fd); return 0; }
-  uint64_t h = 0;
+  whash64_t h;
+  whash64_init(&h);
+  int ok = 1;
   for (;;) {
     ssize_t r = read(fd, buf, chunk);
-    if (r < 0) { if (errno == EINTR) continue; h = 0; break; }
+    if (r < 0) { if (errno == EINTR) continue; ok = 0; break; }
     if (r == 0) break;
-    h = fnv1a64_update(h, buf, (size_t)r);
+    whash64_update(&h, buf, (size_t)r);
   }
   free(buf);
   close(fd);
-  return h;
+  return ok ? whash64_final(&h) : 0;
 }
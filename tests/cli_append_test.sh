@@ -0,0 +1,30 @@
+#!/bin/sh
+# append -> cat -> compact through the CLI: the first append creates the
+# container, the second adds the grown tail, and cat must give back the
+# input before and after compact.
+# usage: cli_append_test.sh <warpc> <scratch-dir>
+set -e
+warpc=$1
+dir=$2/cli_append
+rm -rf "$dir"
+mkdir -p "$dir"
+
+# a growing log: every run with a larger n has the same prefix
+gen() { awk -v n="$1" 'BEGIN { for (i = 0; i < n; i++) printf "%08d %d\n", i, (i * 7919) % 1000 }'; }
+
+gen 200000 > "$dir/log"
+"$warpc" append "$dir/log" "$dir/log.warp"
+"$warpc" cat "$dir/log.warp" | cmp - "$dir/log"
+
+gen 500000 > "$dir/log"
+"$warpc" append "$dir/log" "$dir/log.warp"
+"$warpc" append "$dir/log" "$dir/log.warp" # nothing new
+"$warpc" cat "$dir/log.warp" | cmp - "$dir/log"
+"$warpc" cat --offset 1999990 --length 20 "$dir/log.warp" > "$dir/range"
+tail -c +1999991 "$dir/log" | head -c 20 | cmp - "$dir/range"
+
+"$warpc" compact "$dir/log.warp"
+"$warpc" cat "$dir/log.warp" | cmp - "$dir/log"
+
+rm -rf "$dir"
+echo "append/cat/compact ok"